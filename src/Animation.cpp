@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "Animation.hh"
+
+AnimatedBlob::AnimatedBlob(Blob& blob, Scene& scene, double tolerance)
+    : blob(blob)
+    , tolerance(tolerance)
+    , brick_size(std::max(blob.brick_size, 1))
+    , pool(blob.threads)
+{
+  int number_cubes = std::max(blob.cube_count(), 0);
+  bricks_per_axis = (number_cubes + brick_size - 1) / brick_size;
+  std::vector<std::shared_ptr<Object>> objects;
+  for (int x = 0; x < number_cubes; x += brick_size) {
+    for (int y = 0; y < number_cubes; y += brick_size) {
+      for (int z = 0; z < number_cubes; z += brick_size) {
+        BlobBrick brick;
+        brick.x = x;
+        brick.y = y;
+        brick.z = z;
+        brick.size_x = std::min(brick_size, number_cubes - x);
+        brick.size_y = std::min(brick_size, number_cubes - y);
+        brick.size_z = std::min(brick_size, number_cubes - z);
+        brick.box = BoundingBox().expand(blob.lattice_point(x, y, z))
+                        .expand(blob.lattice_point(x + brick.size_x, y + brick.size_y, z + brick.size_z));
+        brick.drift = std::numeric_limits<double>::infinity();
+        brick.mesh = std::make_shared<TriangleMesh>(blob.texture_material, std::vector<Point3>(),
+                                                    std::vector<std::uint32_t>());
+        objects.push_back(brick.mesh);
+        bricks.push_back(std::move(brick));
+      }
+    }
+  }
+  scene.add_object(objects);
+  meshed_centers = blob.blobs_origin;
+  update();
+}
+
+std::size_t AnimatedBlob::brick_index(int x, int y, int z) const {
+  return (static_cast<std::size_t>(x) * bricks_per_axis + y) * bricks_per_axis + z;
+}
+
+void AnimatedBlob::accumulate_drift() {
+  const std::vector<Point3>& centers = blob.blobs_origin;
+  if (centers.size() != meshed_centers.size()) {
+    for (auto& brick : bricks) {
+      brick.drift = std::numeric_limits<double>::infinity();
+    }
+    meshed_centers = centers;
+    return;
+  }
+  Point3 origin = blob.lattice_point(0, 0, 0);
+  double number_cubes = blob.cube_count();
+  //Bricks whose cubes overlap [low, high] along one axis, false if there is none
+  auto brick_range = [&](double low, double high, int& first, int& last) {
+    if (high < 0 || low > number_cubes) {
+      return false;
+    }
+    first = static_cast<int>(std::max(low, 0.0)) / brick_size;
+    last = std::min(static_cast<int>(std::min(high, number_cubes)) / brick_size, bricks_per_axis - 1);
+    return true;
+  };
+  for (std::size_t i = 0; i < centers.size(); ++i) {
+    const Point3& from = meshed_centers[i];
+    const Point3& to = centers[i];
+    if (from.x == to.x && from.y == to.y && from.z == to.z) {
+      continue;
+    }
+    if (blob.kernel != BlobKernel::wyvill) {
+      for (auto& brick : bricks) {
+        brick.drift += blob.potential_change_bound(brick.box, from, to);
+      }
+      continue;
+    }
+    //Only the bricks within the support radius of the path of the center can change
+    BoundingBox reach = BoundingBox().expand(from).expand(to).pad(blob.support_radius);
+    int first_x, last_x, first_y, last_y, first_z, last_z;
+    if (!brick_range((reach.min.x - origin.x) / blob.d, (reach.max.x - origin.x) / blob.d, first_x, last_x)
+        || !brick_range((reach.min.y - origin.y) / blob.d, (reach.max.y - origin.y) / blob.d, first_y, last_y)
+        || !brick_range((origin.z - reach.max.z) / blob.d, (origin.z - reach.min.z) / blob.d, first_z, last_z)) {
+      continue;
+    }
+    for (int x = first_x; x <= last_x; ++x) {
+      for (int y = first_y; y <= last_y; ++y) {
+        for (int z = first_z; z <= last_z; ++z) {
+          BlobBrick& brick = bricks[brick_index(x, y, z)];
+          brick.drift += blob.potential_change_bound(brick.box, from, to);
+        }
+      }
+    }
+  }
+  meshed_centers = centers;
+}
+
+bool AnimatedBlob::refresh(BlobBrick& brick) const {
+  double lower, upper;
+  blob.potential_bounds(brick.box, lower, upper);
+  if (upper < blob.threshold || blob.satisfy_threshold(lower)) {
+    //Entirely inside or outside of the blob, there is no need to sample it
+    brick.potentials.clear();
+    brick.drift = 0;
+    if (brick.mesh->triangle_count() == 0) {
+      return false;
+    }
+    *brick.mesh = TriangleMesh(blob.texture_material, {}, {});
+    return true;
+  }
+
+  std::vector<double> potentials = blob.brick_potentials(brick.x, brick.y, brick.z, brick.size_x, brick.size_y,
+                                                         brick.size_z);
+  //The bound can be far above the real change, the mesh is kept if the samples barely moved
+  if (potentials.size() == brick.potentials.size()) {
+    double change = 0;
+    for (std::size_t i = 0; i < potentials.size(); ++i) {
+      change = std::max(change, std::fabs(potentials[i] - brick.potentials[i]));
+    }
+    if (change <= tolerance) {
+      brick.drift = change;
+      return false;
+    }
+  }
+
+  BlobMeshChunk chunk = blob.polygonize_brick(brick.x, brick.y, brick.z, brick.size_x, brick.size_y, brick.size_z,
+                                              potentials);
+  *brick.mesh = TriangleMesh(blob.texture_material, std::move(chunk.vertices), std::move(chunk.indices),
+                             std::move(chunk.normals));
+  brick.potentials = std::move(potentials);
+  brick.drift = 0;
+  return true;
+}
+
+std::size_t AnimatedBlob::update() {
+  blob.index_centers();
+  accumulate_drift();
+  std::vector<std::size_t> moved;
+  for (std::size_t i = 0; i < bricks.size(); ++i) {
+    if (bricks[i].drift > tolerance) {
+      moved.push_back(i);
+    }
+  }
+  std::vector<char> remeshed(moved.size(), 0);
+  pool.parallel_for(moved.size(), [&](std::size_t i, unsigned int) {
+    remeshed[i] = refresh(bricks[moved[i]]);
+  });
+  return std::count(remeshed.begin(), remeshed.end(), 1);
+}
+
+Animation::Animation(Scene& scene)
+    : scene(scene) {}
+
+AnimatedBlob& Animation::add_blob(Blob& blob, double tolerance) {
+  blobs.push_back(std::make_unique<AnimatedBlob>(blob, scene, tolerance));
+  return *blobs.back();
+}
+
+void Animation::step(double duration) {
+  time += duration;
+  if (advance) {
+    advance(time);
+  }
+  remeshed_bricks = 0;
+  for (auto& blob : blobs) {
+    remeshed_bricks += blob->update();
+  }
+  scene.refit_acceleration();
+}
+
+void Animation::render(int frame_count, double frame_duration, const std::string& path_prefix) {
+  for (int frame = 0; frame < frame_count; ++frame) {
+    step(frame == 0 ? 0.0 : frame_duration);
+    std::ostringstream filename;
+    filename << path_prefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+    PpmSink sink(filename.str());
+    scene.raycasting(sink);
+    std::cout << "Frame " << frame << " : " << remeshed_bricks << " bricks remeshed\n";
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Blob.hh"
+#include "Scene.hh"
+#include "TriangleMesh.hh"
+
+//Cubes [x, x + size_x) x [y, y + size_y) x [z, z + size_z) of the lattice of a blob, meshed on their own
+struct BlobBrick
+{
+  int x;
+  int y;
+  int z;
+  int size_x;
+  int size_y;
+  int size_z;
+  BoundingBox box;
+  std::vector<double> potentials; //brick_potentials the mesh was built from, empty when the bounds showed no surface
+  double drift; //Upper bound of how much the potential changed on the brick since these values
+  std::shared_ptr<TriangleMesh> mesh; //Registered once in the scene and rebuilt in place
+};
+
+//Mesh of a blob whose centers move, split in bricks of blob.brick_size cubes that are each a TriangleMesh of the scene
+//update only remeshes the bricks where the potential may have moved by more than tolerance since they were meshed,
+//the objects of the scene stay the same so its BVH can be refitted instead of built again
+class AnimatedBlob
+{
+public:
+  AnimatedBlob(Blob& blob, Scene& scene, double tolerance);
+
+  //To call once the centers of the blob moved, returns the number of bricks remeshed
+  std::size_t update();
+
+  Blob& blob;
+  double tolerance;
+  std::vector<BlobBrick> bricks;
+
+private:
+  //Adds to the drift of the bricks the change bound of every center that moved since the last update
+  void accumulate_drift();
+
+  //Checks the brick against the current potential, returns true if its mesh changed
+  bool refresh(BlobBrick& brick) const;
+
+  [[nodiscard]] std::size_t brick_index(int x, int y, int z) const;
+
+  int brick_size;
+  int bricks_per_axis = 0;
+  std::vector<Point3> meshed_centers; //Centers of the blob at the last update
+  ThreadPool pool;
+};
+
+//Renders a scene at successive times, advance puts the scene in its state at a given time and the blobs registered
+//here are remeshed incrementally, the frames are saved as a numbered sequence
+class Animation
+{
+public:
+  explicit Animation(Scene& scene);
+
+  //Meshes blob into the scene by bricks, advance can then move its centers
+  AnimatedBlob& add_blob(Blob& blob, double tolerance);
+
+  //Moves time forward by duration, calls advance, remeshes the blobs and refits the BVH of the scene
+  void step(double duration);
+
+  //Renders frame_count frames frame_duration apart starting at the current time, saved as path_prefix followed by the
+  //frame number on four digits
+  void render(int frame_count, double frame_duration, const std::string& path_prefix);
+
+  Scene& scene;
+  std::function<void(double time)> advance; //Can move any object of the scene in place, step refits the BVH after it
+  double time = 0;
+  std::vector<std::unique_ptr<AnimatedBlob>> blobs;
+  std::size_t remeshed_bricks = 0; //By the last step
+};
@@ -0,0 +1,130 @@
+#include "BVH.hh"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+void BVH::build(const std::vector<BoundingBox>& boxes) {
+  nodes.clear();
+  primitives.resize(boxes.size());
+  std::iota(primitives.begin(), primitives.end(), 0);
+  if (boxes.empty()) {
+    return;
+  }
+  std::vector<Point3> centroids;
+  centroids.reserve(boxes.size());
+  for (const auto& box : boxes) {
+    //An empty box can never be hit, it only has to be put somewhere
+    centroids.push_back(box.is_empty() ? Point3() : box.centroid());
+  }
+  nodes.reserve(2 * boxes.size());
+  build_node(boxes, centroids, 0, boxes.size(), 0);
+}
+
+bool BVH::is_empty() const {
+  return nodes.empty();
+}
+
+void BVH::refit(const std::vector<BoundingBox>& boxes) {
+  //The children of a node are stored after it, going backwards updates them first
+  for (std::size_t index = nodes.size(); index-- > 0;) {
+    BVHNode& node = nodes[index];
+    BoundingBox box;
+    if (node.count > 0) {
+      for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+        box.expand(boxes[primitives[i]]);
+      }
+    } else {
+      box.expand(nodes[index + 1].box).expand(nodes[node.first].box);
+    }
+    node.box = box;
+  }
+}
+
+double BVH::total_surface_area() const {
+  double area = 0;
+  for (const auto& node : nodes) {
+    area += node.box.surface_area();
+  }
+  return area;
+}
+
+std::uint32_t BVH::build_node(const std::vector<BoundingBox>& boxes, const std::vector<Point3>& centroids
+                              , std::uint32_t begin, std::uint32_t end, int depth) {
+  std::uint32_t index = nodes.size();
+  nodes.emplace_back();
+  BoundingBox box;
+  BoundingBox centroid_box;
+  for (std::uint32_t i = begin; i < end; ++i) {
+    box.expand(boxes[primitives[i]]);
+    centroid_box.expand(centroids[primitives[i]]);
+  }
+  nodes[index].box = box;
+  nodes[index].first = begin;
+  nodes[index].count = end - begin;
+
+  std::uint32_t count = end - begin;
+  if (count <= max_leaf_size) {
+    return index;
+  }
+  int axis = centroid_box.largest_axis();
+  double axis_min = centroid_box.min[axis];
+  double axis_extent = centroid_box.max[axis] - axis_min;
+
+  std::uint32_t mid = begin;
+  if (axis_extent > 0.0 && depth < max_sah_depth) {
+    //Binned surface area heuristic
+    constexpr int bin_count = 12;
+    std::array<BoundingBox, bin_count> bin_boxes;
+    std::array<std::uint32_t, bin_count> bin_counts = {};
+    auto bin_of = [&](std::uint32_t primitive) {
+      int bin = bin_count * (centroids[primitive][axis] - axis_min) / axis_extent;
+      return std::min(bin, bin_count - 1);
+    };
+    for (std::uint32_t i = begin; i < end; ++i) {
+      int bin = bin_of(primitives[i]);
+      bin_boxes[bin].expand(boxes[primitives[i]]);
+      ++bin_counts[bin];
+    }
+    std::array<double, bin_count - 1> left_costs = {};
+    BoundingBox accumulated;
+    std::uint32_t accumulated_count = 0;
+    for (int i = 0; i < bin_count - 1; ++i) {
+      accumulated.expand(bin_boxes[i]);
+      accumulated_count += bin_counts[i];
+      left_costs[i] = accumulated_count * accumulated.surface_area();
+    }
+    accumulated = BoundingBox();
+    accumulated_count = 0;
+    int best_split = 0;
+    double best_cost = 0.0;
+    for (int i = bin_count - 1; i > 0; --i) {
+      accumulated.expand(bin_boxes[i]);
+      accumulated_count += bin_counts[i];
+      double cost = left_costs[i - 1] + accumulated_count * accumulated.surface_area();
+      if (i == bin_count - 1 || cost < best_cost) {
+        best_cost = cost;
+        best_split = i - 1;
+      }
+    }
+    //Splitting is not worth it when testing every primitive is cheaper, unless the leaf would be too big
+    double leaf_cost = count * box.surface_area();
+    if (best_cost >= leaf_cost && count <= 4 * max_leaf_size) {
+      return index;
+    }
+    mid = std::partition(primitives.begin() + begin, primitives.begin() + end
+                         , [&](std::uint32_t primitive) { return bin_of(primitive) <= best_split; })
+          - primitives.begin();
+  }
+  if (mid == begin || mid == end) {
+    mid = begin + count / 2;
+    std::nth_element(primitives.begin() + begin, primitives.begin() + mid, primitives.begin() + end
+                     , [&](std::uint32_t a, std::uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+  }
+
+  nodes[index].axis = axis;
+  nodes[index].count = 0;
+  build_node(boxes, centroids, begin, mid, depth + 1);
+  std::uint32_t right = build_node(boxes, centroids, mid, end, depth + 1);
+  nodes[index].first = right;
+  return index;
+}
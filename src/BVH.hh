@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "BoundingBox.hh"
+#include "Rayon.hh"
+
+struct BVHNode
+{
+  BoundingBox box;
+  std::uint32_t first = 0; //Index of the first primitive for a leaf, index of the second child for an inner node
+  std::uint32_t count = 0; //Number of primitives of a leaf, 0 for an inner node
+  int axis = 0; //Split axis of an inner node, used to visit the nearest child first
+};
+
+//Bounding volume hierarchy over primitives identified by their index in the boxes given to build
+//The nodes are stored depth first, the first child of an inner node is the node right after it
+class BVH
+{
+public:
+  void build(const std::vector<BoundingBox>& boxes);
+
+  [[nodiscard]] bool is_empty() const;
+
+  //Recomputes the boxes of the nodes from new boxes of the same primitives, the tree itself is kept
+  void refit(const std::vector<BoundingBox>& boxes);
+
+  //Sum of the surface areas of the nodes, proportional to the expected cost of a traversal
+  [[nodiscard]] double total_surface_area() const;
+
+  //Nearest hit query, intersect(primitive, t_max) tests one primitive and returns true if it found a hit closer
+  //than t_max, in which case it has lowered t_max to the distance of this hit
+  template <typename Intersect>
+  bool find_nearest(const Rayon& ray, double& t_max, Intersect&& intersect) const;
+
+  //Nearest hit query for a packet, the nodes are visited while one of the rays can still find a closer hit
+  //intersect(primitive) tests the whole packet against one primitive and records the closer hits in closest
+  template <typename Intersect>
+  void find_nearest(const RayPacket& packet, const PacketHit& closest, Intersect&& intersect) const;
+
+  //Any hit query, occlude(primitive) returns true if the primitive blocks the ray and the traversal stops there
+  template <typename Occlude>
+  bool find_any(const Rayon& ray, double t_max, Occlude&& occlude) const;
+
+  std::vector<BVHNode> nodes;
+  std::vector<std::uint32_t> primitives; //Leaves reference a contiguous range of this vector
+  unsigned int max_leaf_size = 4;
+
+private:
+  std::uint32_t build_node(const std::vector<BoundingBox>& boxes, const std::vector<Point3>& centroids
+                           , std::uint32_t begin, std::uint32_t end, int depth);
+
+  //Past this depth the nodes are split at the median so the traversal stack can never overflow
+  static constexpr int max_sah_depth = 32;
+  static constexpr int stack_capacity = 64;
+};
+
+inline Vector3 inverse_direction(const Vector3& direction) {
+  return Vector3(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+}
+
+template <typename Intersect>
+bool BVH::find_nearest(const Rayon& ray, double& t_max, Intersect&& intersect) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  Vector3 inv_direction = inverse_direction(ray.direction);
+  bool direction_negative[3] = {ray.direction.x < 0, ray.direction.y < 0, ray.direction.z < 0};
+  std::uint32_t stack[stack_capacity];
+  int stack_size = 0;
+  std::uint32_t current = 0;
+  bool found = false;
+  while (true) {
+    const BVHNode& node = nodes[current];
+    if (node.box.is_intersecting(ray, inv_direction, t_max)) {
+      if (node.count > 0) {
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+          if (intersect(primitives[i], t_max)) {
+            found = true;
+          }
+        }
+      } else {
+        //Front to back so that t_max shrinks as early as possible
+        if (direction_negative[node.axis]) {
+          stack[stack_size++] = current + 1;
+          current = node.first;
+        } else {
+          stack[stack_size++] = node.first;
+          current = current + 1;
+        }
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      break;
+    }
+    current = stack[--stack_size];
+  }
+  return found;
+}
+
+template <typename Intersect>
+void BVH::find_nearest(const RayPacket& packet, const PacketHit& closest, Intersect&& intersect) const {
+  if (nodes.empty()) {
+    return;
+  }
+  //The rays of a packet are coherent, the first one decides the order of the children for all of them
+  bool direction_negative[3] = {packet.direction.x[0] < 0, packet.direction.y[0] < 0, packet.direction.z[0] < 0};
+  std::uint32_t stack[stack_capacity];
+  int stack_size = 0;
+  std::uint32_t current = 0;
+  while (true) {
+    const BVHNode& node = nodes[current];
+    if (any(node.box.is_intersecting(packet, closest.t))) {
+      if (node.count > 0) {
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+          intersect(primitives[i]);
+        }
+      } else {
+        if (direction_negative[node.axis]) {
+          stack[stack_size++] = current + 1;
+          current = node.first;
+        } else {
+          stack[stack_size++] = node.first;
+          current = current + 1;
+        }
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      break;
+    }
+    current = stack[--stack_size];
+  }
+}
+
+template <typename Occlude>
+bool BVH::find_any(const Rayon& ray, double t_max, Occlude&& occlude) const {
+  if (nodes.empty()) {
+    return false;
+  }
+  Vector3 inv_direction = inverse_direction(ray.direction);
+  std::uint32_t stack[stack_capacity];
+  int stack_size = 0;
+  std::uint32_t current = 0;
+  while (true) {
+    const BVHNode& node = nodes[current];
+    if (node.box.is_intersecting(ray, inv_direction, t_max)) {
+      if (node.count > 0) {
+        for (std::uint32_t i = node.first; i < node.first + node.count; ++i) {
+          if (occlude(primitives[i])) {
+            return true;
+          }
+        }
+      } else {
+        stack[stack_size++] = node.first;
+        current = current + 1;
+        continue;
+      }
+    }
+    if (stack_size == 0) {
+      break;
+    }
+    current = stack[--stack_size];
+  }
+  return false;
+}
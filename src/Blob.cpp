@@ -1,5 +1,11 @@
 #include "Blob.hh"
+#include "Simd.hh"
+#include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
 
 Blob::Blob(Point3 center, double e, double d, std::vector<Point3> blobs_origin, double threshold
 , std::shared_ptr<Texture_Material> texture_material)
@@ -10,8 +16,32 @@ Blob::Blob(Point3 center, double e, double d, std::vector<Point3> blobs_origin,
   , threshold(threshold)
   , texture_material(texture_material) {}
 
-double Blob::potential(const Point3& point) {
+void Blob::use_compact_kernel(double support_radius) {
+  this->kernel = BlobKernel::wyvill;
+  this->support_radius = support_radius;
+  index_centers();
+}
+
+void Blob::index_centers() {
+  if (kernel == BlobKernel::wyvill) {
+    centers_grid.build(blobs_origin, support_radius);
+  }
+}
+
+double Blob::potential(const Point3& point) const {
   double value = 0;
+  if (kernel == BlobKernel::wyvill) {
+    double inv_squared_radius = 1.0 / (support_radius * support_radius);
+    centers_grid.for_each_near(point, [&](std::uint32_t index) {
+      Vector3 distance(blobs_origin[index], point);
+      double ratio = distance.scalar_product(distance) * inv_squared_radius;
+      if (ratio < 1.0) {
+        double falloff = 1.0 - ratio;
+        value += falloff * falloff * falloff;
+      }
+    });
+    return value;
+  }
   for (const auto& blob : blobs_origin) {
     Vector3 distance(blob, point);
     value += 1.0 / (distance.x * distance.x + distance.y * distance.y + distance.z * distance.z);
@@ -19,15 +49,104 @@ double Blob::potential(const Point3& point) {
   return value;
 }
 
-bool Blob::satisfy_threshold(double value) {
+//Adds the kernel of every center to the points of a row, `lanes` points at a time, the point k is at height
+//points[k] along the row and the center c is planar[c] away from its line, squared, at height heights[c]
+template <int lanes, typename Real, typename Scalar, typename Kernel>
+static void accumulate_row(const std::vector<Scalar>& points, const std::vector<Scalar>& planar,
+                           const std::vector<Scalar>& heights, std::vector<Scalar>& sums, Kernel kernel) {
+  for (std::size_t k = 0; k < points.size(); k += lanes) {
+    Real point = Real::load(&points[k]);
+    Real sum;
+    for (std::size_t c = 0; c < planar.size(); ++c) {
+      Real height = point - Real(heights[c]);
+      sum = sum + kernel(Real(planar[c]) + height * height);
+    }
+    sum.store(&sums[k]);
+  }
+}
+
+void Blob::potential_row(int x, int y, int z, int count, double* values) const {
+  if (count <= 0) {
+    return;
+  }
+  Point3 first = lattice_point(x, y, z);
+  Point3 last = lattice_point(x, y, z + count - 1);
+  double inv_squared_radius = kernel == BlobKernel::wyvill ? 1.0 / (support_radius * support_radius) : 0.0;
+  std::vector<double> planar;
+  std::vector<double> heights;
+  auto add_center = [&](const Point3& center) {
+    double planar_x = first.x - center.x;
+    double planar_y = first.y - center.y;
+    planar.push_back(planar_x * planar_x + planar_y * planar_y);
+    heights.push_back(center.z);
+  };
+  if (kernel == BlobKernel::wyvill) {
+    //z goes down in the lattice so the last point is the lowest
+    centers_grid.for_each_near(last, first, [&](std::uint32_t index) { add_center(blobs_origin[index]); });
+  } else {
+    planar.reserve(blobs_origin.size());
+    heights.reserve(blobs_origin.size());
+    for (const auto& center : blobs_origin) {
+      add_center(center);
+    }
+  }
+
+  //The rows are padded to whole packets with copies of their last point
+  int lanes = single_precision ? 8 : 4;
+  std::size_t padded = (count + lanes - 1) / lanes * lanes;
+  if (!single_precision) {
+    std::vector<double> points(padded);
+    std::vector<double> sums(padded);
+    for (std::size_t k = 0; k < padded; ++k) {
+      points[k] = lattice_point(x, y, z + std::min<int>(k, count - 1)).z;
+    }
+    if (kernel == BlobKernel::wyvill) {
+      accumulate_row<4, Double4>(points, planar, heights, sums, [&](Double4 squared) {
+        Double4 falloff = max(Double4(1.0) - squared * Double4(inv_squared_radius), Double4(0.0));
+        return falloff * falloff * falloff;
+      });
+    } else {
+      accumulate_row<4, Double4>(points, planar, heights, sums, [](Double4 squared) { return Double4(1.0) / squared; });
+    }
+    std::copy(sums.begin(), sums.begin() + count, values);
+    return;
+  }
+
+  //Heights relative to the first point of the row keep the precision of the floats
+  std::vector<float> points(padded);
+  std::vector<float> sums(padded);
+  std::vector<float> planar_single(planar.begin(), planar.end());
+  std::vector<float> heights_single(heights.size());
+  for (std::size_t k = 0; k < padded; ++k) {
+    points[k] = lattice_point(x, y, z + std::min<int>(k, count - 1)).z - first.z;
+  }
+  for (std::size_t c = 0; c < heights.size(); ++c) {
+    heights_single[c] = heights[c] - first.z;
+  }
+  if (kernel == BlobKernel::wyvill) {
+    float inv_squared = inv_squared_radius;
+    accumulate_row<8, Float8>(points, planar_single, heights_single, sums, [&](Float8 squared) {
+      Float8 falloff = max(Float8(1.0f) - squared * Float8(inv_squared), Float8(0.0f));
+      return falloff * falloff * falloff;
+    });
+  } else {
+    //A point on a center gets a huge potential instead of the NaN of the reciprocal of 0
+    Float8 smallest(std::numeric_limits<float>::min());
+    accumulate_row<8, Float8>(points, planar_single, heights_single, sums,
+                              [&](Float8 squared) { return reciprocal(max(squared, smallest)); });
+  }
+  std::copy(sums.begin(), sums.begin() + count, values);
+}
+
+bool Blob::satisfy_threshold(double value) const {
   return value >= threshold;
 }
 
-bool Blob::is_in_blob(const Point3& point) {
+bool Blob::is_in_blob(const Point3& point) const {
   return this->potential(point) >= threshold;
 }
 
-std::array<bool, 8> Blob::are_in_blob(const std::array<double, 8>& potentials) {
+std::array<bool, 8> Blob::are_in_blob(const std::array<double, 8>& potentials) const {
   std::array<bool, 8> in_blob;
   for (int index = 0; index < 8; ++index) {
     in_blob[index] = satisfy_threshold(potentials[index]);
@@ -43,7 +162,7 @@ std::array<double, 8> Blob::give_potentials(const std::array<Point3, 8>& boundar
   return potentials;
 }
 
-int Blob::give_index(const std::array<double, 8>& potentials_value) {
+int Blob::give_index(const std::array<double, 8>& potentials_value) const {
   auto potentials = are_in_blob(potentials_value);
   int index = 0;
 
@@ -59,19 +178,34 @@ int Blob::give_index(const std::array<double, 8>& potentials_value) {
   return index;
 }
 
-Vector3 Blob::normal_at_point(const Point3& point) {
-  Vector3 normal(0,0,0);
+Vector3 Blob::gradient(const Point3& point) const {
+  Vector3 gradient(0, 0, 0);
+  if (kernel == BlobKernel::wyvill) {
+    //The derivative of (1 - r^2 / R^2)^3 is -6 / R^2 (1 - r^2 / R^2)^2 (point - center)
+    double inv_squared_radius = 1.0 / (support_radius * support_radius);
+    centers_grid.for_each_near(point, [&](std::uint32_t index) {
+      Vector3 distance(blobs_origin[index], point);
+      double ratio = distance.scalar_product(distance) * inv_squared_radius;
+      if (ratio < 1.0) {
+        gradient += distance * (-6.0 * inv_squared_radius * (1.0 - ratio) * (1.0 - ratio));
+      }
+    });
+    return gradient;
+  }
+  //The derivative of 1 / r^2 is -2 / r^4 (point - center)
   for (const auto& blob_origin : blobs_origin) {
-    normal += Vector3(blob_origin, point).normalize();
+    Vector3 distance(blob_origin, point);
+    double squared = distance.scalar_product(distance);
+    gradient += distance * (-2.0 / (squared * squared));
   }
-  return normal.normalize();
+  return gradient;
 }
 
-void Blob::add_triangles(Scene& scene, int index, const Point3& cube, const std::array<Point3, 12>& edges_position) {
-  //std::array<Point3, 12> edges_position = {
-  //    cube + Point3(d / 2, 0, 0), cube + Point3(d, d / 2, 0), cube + Point3(d / 2 , d, 0), cube + Point3(0, d / 2, 0)
-  //  , cube + Point3(d / 2, 0, -d), cube + Point3(d, d / 2, -d), cube + Point3(d / 2 , d, -d), cube + Point3(0, d / 2, -d)
-  //  , cube + Point3(0, 0, -d / 2), cube + Point3(d, 0, -d / 2), cube + Point3(d, d, -d / 2), cube + Point3(0, d, -d / 2)};
+Vector3 Blob::normal_at_point(const Point3& point) const {
+  return (-gradient(point)).normalize();
+}
+
+void Blob::add_triangles(Scene& scene, int index, const Point3&, const std::array<Point3, 12>& edges_position) {
   auto triangles_edges = triangle_configurations[index];
   int i = 0;
   while (triangles_edges[i] != -1) {
@@ -101,38 +235,377 @@ Point3 Blob::interpolated_value(const Point3& A, const Point3& B, double A_poten
 }
 
 std::array<Point3, 12> Blob::edges_position(const std::array<Point3, 8>& boundaries, const std::array<double, 8>& potentials) const {
-  //The vertices are grouped by two
-  std::array<int, 24> vertices = {0,1, 1,2, 2,3, 3,0, 4,5, 5,6, 6,7, 7,4, 0,4, 1,5, 2,6, 3,7};
   std::array<Point3, 12> edges = {};
-  for (int index = 0; index < 24; index += 2) {
-    edges[index / 2] = interpolated_value(boundaries[vertices[index]], boundaries[vertices[index + 1]],
-                                          potentials[vertices[index]], potentials[vertices[index + 1]]);
+  for (int edge = 0; edge < 12; ++edge) {
+    edges[edge] = interpolated_value(boundaries[cube_edges[edge][0]], boundaries[cube_edges[edge][1]],
+                                     potentials[cube_edges[edge][0]], potentials[cube_edges[edge][1]]);
   }
   return edges;
 }
 
-void Blob::marching_cubes(Scene& scene) {
+int Blob::cube_count() const {
+  return this->e / this->d;
+}
 
-  int number_cubes = this->e / this->d;
+Point3 Blob::lattice_point(int x, int y, int z) const {
   Point3 origin = this->center + Point3(-1 * this->e / 2, - 1 * this->e / 2, this->e / 2);
-  Point3 current = origin;
-  for (int x = 0; x < number_cubes; ++x) {
-    for (int y = 0; y < number_cubes; ++y) {
-      for (int z = 0; z < number_cubes; ++z) {
-        std::array<Point3, 8> boundaries = {
-            current, current + Point3(d, 0, 0), current + Point3(d, d, 0), current + Point3(0, d, 0)
-            , current + Point3(0, 0, -d), current + Point3(d, 0, -d), current + Point3(d, d, -d), current + Point3(0, d, -d)};
-        auto potentials = give_potentials(boundaries);
-        auto edges = edges_position(boundaries, potentials);
-        int index = give_index(give_potentials(boundaries));
-        add_triangles(scene, index, current, edges);
-
-        current += Point3(0, 0, -d);
+  return origin + Point3(x * d, y * d, -z * d);
+}
+
+std::vector<double> Blob::potential_grid(ThreadPool& pool) const {
+  std::size_t points = cube_count() + 1;
+  std::vector<double> grid(points * points * points);
+  pool.parallel_for(points, [&](std::size_t x, unsigned int) {
+    for (std::size_t y = 0; y < points; ++y) {
+      potential_row(x, y, 0, points, &grid[(x * points + y) * points]);
+    }
+  });
+  return grid;
+}
+
+//Derivative along one axis of the lattice per step, value is at coordinate among points along the axis
+static double lattice_derivative(const double* value, std::ptrdiff_t stride, int coordinate, int points) {
+  if (points < 3) {
+    return coordinate == 0 ? value[stride] - value[0] : value[0] - value[-stride];
+  }
+  if (coordinate == 0) {
+    return (-3.0 * value[0] + 4.0 * value[stride] - value[2 * stride]) / 2;
+  }
+  if (coordinate == points - 1) {
+    return (3.0 * value[0] - 4.0 * value[-stride] + value[-2 * stride]) / 2;
+  }
+  return (value[stride] - value[-stride]) / 2;
+}
+
+std::vector<Vector3> Blob::gradient_grid(int size_x, int size_y, int size_z, const double* potentials,
+                                         std::size_t stride_x, std::size_t stride_y, const BlockHalo& halo) const {
+  const int points[3] = {size_x + 1, size_y + 1, size_z + 1};
+  const int sampled[3] = {halo.points(0, size_x), halo.points(1, size_y), halo.points(2, size_z)};
+  const std::ptrdiff_t strides[3] = {static_cast<std::ptrdiff_t>(stride_x), static_cast<std::ptrdiff_t>(stride_y), 1};
+  const double scales[3] = {1.0 / d, 1.0 / d, -1.0 / d}; //z goes down in the lattice
+  std::vector<Vector3> gradients(static_cast<std::size_t>(points[0]) * points[1] * points[2]);
+  std::size_t index = 0;
+  for (int x = 0; x < points[0]; ++x) {
+    for (int y = 0; y < points[1]; ++y) {
+      for (int z = 0; z < points[2]; ++z) {
+        const double* value = potentials + x * stride_x + y * stride_y + z;
+        const int coordinates[3] = {x, y, z};
+        Vector3& gradient = gradients[index++];
+        for (int axis = 0; axis < 3; ++axis) {
+          gradient[axis] = scales[axis] * lattice_derivative(value, strides[axis], halo.before[axis] + coordinates[axis],
+                                                             sampled[axis]);
+        }
+      }
+    }
+  }
+  return gradients;
+}
+
+//The lattice points one step around the brick, where there are some
+static BlockHalo brick_halo(int number_cubes, int x, int y, int z, int size_x, int size_y, int size_z) {
+  const int start[3] = {x, y, z};
+  const int sizes[3] = {size_x, size_y, size_z};
+  BlockHalo halo;
+  for (int axis = 0; axis < 3; ++axis) {
+    halo.before[axis] = start[axis] > 0 ? 1 : 0;
+    halo.after[axis] = start[axis] + sizes[axis] < number_cubes ? 1 : 0;
+  }
+  return halo;
+}
+
+std::vector<double> Blob::brick_potentials(int x, int y, int z, int size_x, int size_y, int size_z) const {
+  BlockHalo halo = brick_halo(cube_count(), x, y, z, size_x, size_y, size_z);
+  int points_x = halo.points(0, size_x);
+  int points_y = halo.points(1, size_y);
+  int points_z = halo.points(2, size_z);
+  std::vector<double> potentials(static_cast<std::size_t>(points_x) * points_y * points_z);
+  for (int i = 0; i < points_x; ++i) {
+    for (int j = 0; j < points_y; ++j) {
+      potential_row(x - halo.before[0] + i, y - halo.before[1] + j, z - halo.before[2], points_z,
+                    &potentials[(static_cast<std::size_t>(i) * points_y + j) * points_z]);
+    }
+  }
+  return potentials;
+}
+
+BlobMeshChunk Blob::polygonize_brick(int x, int y, int z, int size_x, int size_y, int size_z,
+                                     const std::vector<double>& potentials) const {
+  BlockHalo halo = brick_halo(cube_count(), x, y, z, size_x, size_y, size_z);
+  std::size_t stride_y = halo.points(2, size_z);
+  std::size_t stride_x = halo.points(1, size_y) * stride_y;
+  const double* block = potentials.data() + halo.before[0] * stride_x + halo.before[1] * stride_y + halo.before[2];
+  return polygonize_block(x, y, z, size_x, size_y, size_z, block, stride_x, stride_y, halo);
+}
+
+BlobMeshChunk Blob::polygonize_block(int x0, int y0, int z0, int size_x, int size_y, int size_z,
+                                     const double* potentials, std::size_t stride_x, std::size_t stride_y,
+                                     const BlockHalo& halo) const {
+  constexpr std::uint32_t no_vertex = std::numeric_limits<std::uint32_t>::max();
+  BlobMeshChunk chunk;
+  //The edge (x, y, z, axis) goes from the lattice point (x, y, z) of the block to the next one along axis
+  std::size_t points_y = size_y + 1;
+  std::size_t points_z = size_z + 1;
+  std::vector<std::uint32_t> edge_vertex(3 * (size_x + 1) * points_y * points_z, no_vertex);
+  std::uint64_t lattice_points = cube_count() + 1;
+  const int sizes[3] = {size_x, size_y, size_z};
+  std::vector<Vector3> gradients;
+  if (smooth_triangle) {
+    gradients = gradient_grid(size_x, size_y, size_z, potentials, stride_x, stride_y, halo);
+  }
+  constexpr double gradient_agreement = 0.9; //Cosine of the angle between the gradients at the ends of an edge
+  auto gradient_at = [&](int x, int y, int z) -> const Vector3& {
+    return gradients[(x * points_y + y) * points_z + z];
+  };
+
+  for (int x = 0; x < size_x; ++x) {
+    for (int y = 0; y < size_y; ++y) {
+      for (int z = 0; z < size_z; ++z) {
+        std::array<double, 8> corners;
+        for (int corner = 0; corner < 8; ++corner) {
+          corners[corner] = potentials[(x + cube_corners[corner][0]) * stride_x + (y + cube_corners[corner][1]) * stride_y
+                                       + z + cube_corners[corner][2]];
+        }
+        int index = give_index(corners);
+        if (index == 0 || index == 255) {
+          continue;
+        }
+        for (int i = 0; triangle_configurations[index][i] != -1; ++i) {
+          int edge = triangle_configurations[index][i];
+          const int* from = cube_corners[cube_edges[edge][0]];
+          const int* to = cube_corners[cube_edges[edge][1]];
+          int start[3] = {x + std::min(from[0], to[0]), y + std::min(from[1], to[1]), z + std::min(from[2], to[2])};
+          int axis = from[0] != to[0] ? 0 : (from[1] != to[1] ? 1 : 2);
+          std::uint32_t& vertex = edge_vertex[((start[0] * points_y + start[1]) * points_z + start[2]) * 3 + axis];
+          if (vertex == no_vertex) {
+            vertex = chunk.vertices.size();
+            double from_potential = corners[cube_edges[edge][0]];
+            double to_potential = corners[cube_edges[edge][1]];
+            Point3 position = interpolated_value(lattice_point(x0 + x + from[0], y0 + y + from[1], z0 + z + from[2]),
+                                                 lattice_point(x0 + x + to[0], y0 + y + to[1], z0 + z + to[2]),
+                                                 from_potential, to_potential);
+            chunk.vertices.push_back(position);
+            if (smooth_triangle) {
+              double coeff = (threshold - from_potential) / (to_potential - from_potential);
+              const Vector3& from_gradient = gradient_at(x + from[0], y + from[1], z + from[2]);
+              const Vector3& to_gradient = gradient_at(x + to[0], y + to[1], z + to[2]);
+              //Close to a center of the inverse square kernel the field is too steep for the differences, the
+              //gradients of the two ends then disagree and the exact gradient is used instead
+              if (from_gradient.scalar_product(to_gradient)
+                  > gradient_agreement * from_gradient.norm() * to_gradient.norm()) {
+                chunk.normals.push_back((-(from_gradient * (1.0 - coeff) + to_gradient * coeff)).normalize());
+              } else {
+                chunk.normals.push_back(normal_at_point(position));
+              }
+            }
+            //The edges lying on a face of the block are also polygonized by the neighbouring block
+            for (int other = 0; other < 3; ++other) {
+              if (other != axis && (start[other] == 0 || start[other] == sizes[other])) {
+                std::uint64_t key = ((x0 + start[0]) * lattice_points + y0 + start[1]) * lattice_points + z0 + start[2];
+                chunk.shared.emplace_back(key * 3 + axis, vertex);
+                break;
+              }
+            }
+          }
+          chunk.indices.push_back(vertex);
+        }
       }
-      current.z = origin.z;
-      current += Point3(0, d, 0);
     }
-    current.y = origin.y;
-    current += Point3(d, 0, 0);
   }
-}
\ No newline at end of file
+  return chunk;
+}
+
+std::shared_ptr<TriangleMesh> Blob::merge_chunks(const std::vector<BlobMeshChunk>& chunks) const {
+  constexpr std::uint32_t no_vertex = std::numeric_limits<std::uint32_t>::max();
+  std::vector<Point3> vertices;
+  std::vector<Vector3> normals;
+  std::vector<std::uint32_t> indices;
+  std::size_t vertex_count = 0;
+  std::size_t index_count = 0;
+  for (const auto& chunk : chunks) {
+    vertex_count += chunk.vertices.size();
+    index_count += chunk.indices.size();
+  }
+  vertices.reserve(vertex_count);
+  normals.reserve(smooth_triangle ? vertex_count : 0);
+  indices.reserve(index_count);
+
+  std::unordered_map<std::uint64_t, std::uint32_t> welded; //Lattice edge to vertex of the mesh
+  for (const auto& chunk : chunks) {
+    std::vector<std::uint32_t> remap(chunk.vertices.size(), no_vertex);
+    for (const auto& [edge, vertex] : chunk.shared) {
+      auto found = welded.find(edge);
+      if (found != welded.end()) {
+        remap[vertex] = found->second;
+      }
+    }
+    for (std::size_t vertex = 0; vertex < chunk.vertices.size(); ++vertex) {
+      if (remap[vertex] == no_vertex) {
+        remap[vertex] = vertices.size();
+        vertices.push_back(chunk.vertices[vertex]);
+        if (!chunk.normals.empty()) {
+          normals.push_back(chunk.normals[vertex]);
+        }
+      }
+    }
+    for (const auto& [edge, vertex] : chunk.shared) {
+      welded.emplace(edge, remap[vertex]);
+    }
+    for (std::uint32_t index : chunk.indices) {
+      indices.push_back(remap[index]);
+    }
+  }
+  return std::make_shared<TriangleMesh>(texture_material, std::move(vertices), std::move(indices), std::move(normals));
+}
+
+void Blob::marching_cubes(Scene& scene) {
+  if (adaptive) {
+    adaptive_marching_cubes(scene);
+    return;
+  }
+  int number_cubes = cube_count();
+  if (number_cubes <= 0) {
+    return;
+  }
+  ThreadPool pool(threads);
+  std::vector<double> grid = potential_grid(pool);
+  std::size_t points = number_cubes + 1;
+
+  int slab = std::max(brick_size, 1);
+  std::vector<BlobMeshChunk> chunks((number_cubes + slab - 1) / slab);
+  pool.parallel_for(chunks.size(), [&](std::size_t chunk, unsigned int) {
+    int x = chunk * slab;
+    int size_x = std::min(slab, number_cubes - x);
+    //The slabs are views of the whole grid, so their gradients are the ones of the whole grid
+    BlockHalo halo;
+    halo.before[0] = x;
+    halo.after[0] = number_cubes - x - size_x;
+    chunks[chunk] = polygonize_block(x, 0, 0, size_x, number_cubes, number_cubes, grid.data() + x * points * points,
+                                     points * points, points, halo);
+  });
+
+  std::shared_ptr<TriangleMesh> mesh = merge_chunks(chunks);
+  if (mesh->triangle_count() > 0) {
+    scene.add_object(mesh);
+  }
+}
+
+//Each center is between the closest and the farthest point of the box, and every kernel decreases with the distance
+void Blob::potential_bounds(const BoundingBox& box, double& lower, double& upper) const {
+  lower = 0;
+  upper = 0;
+  auto add_center = [&](const Point3& center) {
+    double closest = 0;
+    double farthest = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      double outside = std::max<double>({box.min[axis] - center[axis], center[axis] - box.max[axis], 0.0});
+      double across = std::max(std::fabs(center[axis] - box.min[axis]), std::fabs(center[axis] - box.max[axis]));
+      closest += outside * outside;
+      farthest += across * across;
+    }
+    if (kernel == BlobKernel::wyvill) {
+      double inv_squared_radius = 1.0 / (support_radius * support_radius);
+      double closest_falloff = std::max(1.0 - closest * inv_squared_radius, 0.0);
+      double farthest_falloff = std::max(1.0 - farthest * inv_squared_radius, 0.0);
+      upper += closest_falloff * closest_falloff * closest_falloff;
+      lower += farthest_falloff * farthest_falloff * farthest_falloff;
+    } else {
+      upper += closest > 0 ? 1.0 / closest : std::numeric_limits<double>::infinity();
+      lower += 1.0 / farthest;
+    }
+  };
+  if (kernel == BlobKernel::wyvill) {
+    centers_grid.for_each_near(box.min, box.max, [&](std::uint32_t index) { add_center(blobs_origin[index]); });
+  } else {
+    for (const auto& center : blobs_origin) {
+      add_center(center);
+    }
+  }
+}
+
+static double distance_to_box(const BoundingBox& box, const Point3& point) {
+  double squared = 0;
+  for (int axis = 0; axis < 3; ++axis) {
+    double outside = std::max<double>({box.min[axis] - point[axis], point[axis] - box.max[axis], 0.0});
+    squared += outside * outside;
+  }
+  return std::sqrt(squared);
+}
+
+double Blob::potential_change_bound(const BoundingBox& box, const Point3& from, const Point3& to) const {
+  double move = Vector3(from, to).norm();
+  if (move == 0) {
+    return 0;
+  }
+  //Every point of the path is within move / 2 of one of its ends
+  double closest = std::max(std::min(distance_to_box(box, from), distance_to_box(box, to)) - move / 2, 0.0);
+  if (kernel == BlobKernel::wyvill) {
+    if (closest >= support_radius) {
+      return 0;
+    }
+    //The slope of (1 - r^2 / R^2)^3 is at most 96 / (25 sqrt(5) R), reached at r = R / sqrt(5)
+    return move * 96.0 / (25.0 * std::sqrt(5.0) * support_radius);
+  }
+  if (closest == 0) {
+    return std::numeric_limits<double>::infinity();
+  }
+  //The slope of 1 / r^2 is 2 / r^3
+  return move * 2.0 / (closest * closest * closest);
+}
+
+void Blob::adaptive_marching_cubes(Scene& scene) {
+  int number_cubes = cube_count();
+  if (number_cubes <= 0) {
+    return;
+  }
+  //Octree over the cubes, the nodes are (x, y, z, size) in cubes and are clipped to the lattice
+  int root_size = std::max(brick_size, 1);
+  while (root_size < number_cubes) {
+    root_size *= 2;
+  }
+  std::vector<std::array<int, 4>> bricks;
+  std::vector<std::array<int, 4>> nodes = {{0, 0, 0, root_size}};
+  while (!nodes.empty()) {
+    auto [x, y, z, size] = nodes.back();
+    nodes.pop_back();
+    BoundingBox box;
+    box.expand(lattice_point(x, y, z));
+    box.expand(lattice_point(std::min(x + size, number_cubes), std::min(y + size, number_cubes),
+                             std::min(z + size, number_cubes)));
+    double lower, upper;
+    potential_bounds(box, lower, upper);
+    if (upper < threshold || satisfy_threshold(lower)) {
+      continue; //Every point of the node is on the same side of the surface
+    }
+    if (size <= brick_size) {
+      bricks.push_back({x, y, z, size});
+      continue;
+    }
+    int half = size / 2;
+    for (int child = 7; child >= 0; --child) {
+      int child_x = x + (child & 1) * half;
+      int child_y = y + ((child >> 1) & 1) * half;
+      int child_z = z + ((child >> 2) & 1) * half;
+      if (child_x < number_cubes && child_y < number_cubes && child_z < number_cubes) {
+        nodes.push_back({child_x, child_y, child_z, half});
+      }
+    }
+  }
+
+  //The potentials of a brick are computed once per lattice point of the brick, only the faces shared with the
+  //neighbouring bricks and the halo of one point around them are computed again
+  ThreadPool pool(threads);
+  std::vector<BlobMeshChunk> chunks(bricks.size());
+  pool.parallel_for(bricks.size(), [&](std::size_t brick, unsigned int) {
+    auto [x0, y0, z0, size] = bricks[brick];
+    int size_x = std::min(size, number_cubes - x0);
+    int size_y = std::min(size, number_cubes - y0);
+    int size_z = std::min(size, number_cubes - z0);
+    chunks[brick] = polygonize_brick(x0, y0, z0, size_x, size_y, size_z,
+                                     brick_potentials(x0, y0, z0, size_x, size_y, size_z));
+  });
+
+  std::shared_ptr<TriangleMesh> mesh = merge_chunks(chunks);
+  if (mesh->triangle_count() > 0) {
+    scene.add_object(mesh);
+  }
+}
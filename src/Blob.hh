@@ -1,25 +1,78 @@
 #pragma once
 #include "Vector3.hh"
 #include "Scene.hh"
+#include "ThreadPool.hh"
+#include "PointGrid.hh"
+#include "TriangleMesh.hh"
+#include <cstdint>
+#include <utility>
 #include <vector>
 #include <array>
 
+//Contribution of one center to the field
+//inverse_square is 1 / r^2 and reaches every point of space,
+//wyvill is (1 - r^2 / R^2)^3 and vanishes past the support radius R, so only the close centers are summed
+enum class BlobKernel
+{
+  inverse_square,
+  wyvill
+};
+
+//Indexed triangles of a block of cubes of the lattice, a vertex is made once per lattice edge the surface crosses
+//and is shared by every triangle of the block that uses it
+struct BlobMeshChunk
+{
+  std::vector<Point3> vertices;
+  std::vector<Vector3> normals; //One per vertex, empty when smooth_triangle is not set
+  std::vector<std::uint32_t> indices;
+  std::vector<std::pair<std::uint64_t, std::uint32_t>> shared; //Lattice edge of the vertices on the faces of the block
+};
+
+//Lattice points whose potentials are given around a block along x, y and z, before and after it
+//The gradients on the faces of the block take central differences through them, only the faces of the lattice are
+//left with one-sided ones
+struct BlockHalo
+{
+  int before[3] = {0, 0, 0};
+  int after[3] = {0, 0, 0};
+
+  //Points given along axis for a block of size cubes
+  [[nodiscard]] int points(int axis, int size) const {
+    return before[axis] + size + 1 + after[axis];
+  }
+};
+
 class Blob {
 public:
     Blob(Point3 center, double e, double d, std::vector<Point3> blobs_origin, double threshold
             , std::shared_ptr<Texture_Material> texture_material);
 
-    double potential(const Point3& point);
+    double potential(const Point3& point) const;
+
+    //Potentials of the count lattice points (x, y, z), (x, y, z + 1)... written to values
+    //The points of a row share x and y, so each center is reduced to its distance to the line of the row and its
+    //height, and the loop over the centers runs on four points at a time, eight with single_precision
+    void potential_row(int x, int y, int z, int count, double* values) const;
+
+    //Switches to the wyvill kernel and indexes the centers, the threshold has to be between 0 and 1 with this kernel
+    void use_compact_kernel(double support_radius);
 
-    bool is_in_blob(const Point3& point);
+    //Indexes the centers again, to call after changing blobs_origin with a compact kernel
+    void index_centers();
 
-    bool satisfy_threshold(double value);
+    bool is_in_blob(const Point3& point) const;
 
-    std::array<bool, 8> are_in_blob(const std::array<double, 8>& potentials);
+    bool satisfy_threshold(double value) const;
 
-    int give_index(const std::array<double, 8>& potentials_value);
+    std::array<bool, 8> are_in_blob(const std::array<double, 8>& potentials) const;
 
-    Vector3 normal_at_point(const Point3& point);
+    int give_index(const std::array<double, 8>& potentials_value) const;
+
+    //Gradient of the potential, it points towards the inside of the blob
+    Vector3 gradient(const Point3& point) const;
+
+    //Opposite of the normalized gradient
+    Vector3 normal_at_point(const Point3& point) const;
 
     void add_triangles(Scene& scene, int index, const Point3& cube, const std::array<Point3, 12>& edges_position);
 
@@ -29,8 +82,58 @@ public:
 
     std::array<Point3, 12> edges_position(const std::array<Point3, 8> &boundaries, const std::array<double, 8> &potentials) const;
 
+    //Number of cubes along each axis of the big cube, the lattice has one more point per axis
+    int cube_count() const;
+
+    //Point of the lattice, x and y go along the axes from the corner of the big cube and z goes down
+    Point3 lattice_point(int x, int y, int z) const;
+
+    //Potential of every point of the lattice, indexed by (x * points + y) * points + z with points = cube_count() + 1
+    //Computed once per point instead of once per cube corner, by rows of potential_row in slabs of constant x on the
+    //workers of pool
+    std::vector<double> potential_grid(ThreadPool& pool) const;
+
+    //Triangles of the cubes [x, x + size_x) x [y, y + size_y) x [z, z + size_z), potentials points to the value of
+    //lattice point (x, y, z) and the next points along x and y are stride_x and stride_y further, z is contiguous,
+    //halo tells how many points are also given around the block
+    //The crossing of each edge is interpolated and shaded once, through a cache indexed by the edges of the block
+    //Its normal interpolates the gradient_grid of the block between the two ends of the edge
+    BlobMeshChunk polygonize_block(int x, int y, int z, int size_x, int size_y, int size_z, const double* potentials,
+                                   std::size_t stride_x, std::size_t stride_y, const BlockHalo& halo) const;
+
+    //Gradient at every lattice point of the same block, indexed by (x * (size_y + 1) + y) * (size_z + 1) + z
+    //Central differences of the potentials, second order one-sided differences past the points of the halo
+    std::vector<Vector3> gradient_grid(int size_x, int size_y, int size_z, const double* potentials,
+                                       std::size_t stride_x, std::size_t stride_y, const BlockHalo& halo) const;
+
+    //Potentials of a brick of the lattice and of the points one step around it that are in the lattice, so that the
+    //bricks meshed on their own get the same normals on their common faces
+    std::vector<double> brick_potentials(int x, int y, int z, int size_x, int size_y, int size_z) const;
+
+    //polygonize_block of the brick sampled by brick_potentials
+    BlobMeshChunk polygonize_brick(int x, int y, int z, int size_x, int size_y, int size_z,
+                                   const std::vector<double>& potentials) const;
+
+    //Concatenates the chunks into one mesh, the vertices made by several chunks on their common faces are welded
+    std::shared_ptr<TriangleMesh> merge_chunks(const std::vector<BlobMeshChunk>& chunks) const;
+
+    //Builds the iso surface as a single indexed TriangleMesh, the slabs of brick_size cubes are polygonized in
+    //parallel on `threads` workers and merged in order, so the mesh is the same as with a single thread
+    //Goes through adaptive_marching_cubes when adaptive is set
     void marching_cubes(Scene& scene);
 
+    //Lower and upper bounds of the potential inside box
+    void potential_bounds(const BoundingBox& box, double& lower, double& upper) const;
+
+    //Upper bound of how much the potential changes inside box when one center moves from `from` to `to`
+    //The slope of the kernel at the closest distance between the box and the path of the center, times the move
+    double potential_change_bound(const BoundingBox& box, const Point3& from, const Point3& to) const;
+
+    //Subdivides the lattice as an octree and drops the nodes where the bounds show that the field stays on one side
+    //of the threshold, the bricks left are polygonized at the full resolution d so the surface has no cracks and is
+    //made of the same triangles as with marching_cubes, the time and memory follow the area of the surface
+    void adaptive_marching_cubes(Scene& scene);
+
     Point3 center; //center of big cube
     double e;
     double d;
@@ -38,6 +141,21 @@ public:
     double threshold;
     std::shared_ptr<Texture_Material> texture_material;
     bool smooth_triangle = true;
+    unsigned int threads = 0; //0 uses every hardware thread
+    bool adaptive = false;
+    bool single_precision = false; //potential_row in floats with an approximate reciprocal
+    int brick_size = 8; //Cubes per side of the octree leaves of adaptive_marching_cubes
+    BlobKernel kernel = BlobKernel::inverse_square;
+    double support_radius = 0; //R of the wyvill kernel
+    PointGrid centers_grid; //Cells of support_radius, built by index_centers
+
+  //Offsets of the corners of a cube in the lattice, in the order of triangle_configurations
+  static constexpr int cube_corners[8][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+                                             {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+
+  //Corners at the ends of the edges of a cube, in the numbering of triangle_configurations
+  static constexpr int cube_edges[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6},
+                                            {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
 
   int triangle_configurations[256][15] =
     {
@@ -0,0 +1,122 @@
+#include "BoundingBox.hh"
+#include <algorithm>
+#include <limits>
+
+BoundingBox::BoundingBox()
+    : min(Point3(std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()
+                 , std::numeric_limits<double>::infinity()))
+    , max(Point3(-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()
+                 , -std::numeric_limits<double>::infinity()))
+{}
+
+BoundingBox::BoundingBox(Point3 min, Point3 max)
+    : min(min)
+    , max(max)
+{}
+
+BoundingBox& BoundingBox::expand(const Point3& point) {
+  min = Point3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+  max = Point3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+  return *this;
+}
+
+BoundingBox& BoundingBox::expand(const BoundingBox& box) {
+  if (box.is_empty()) {
+    return *this;
+  }
+  expand(box.min);
+  return expand(box.max);
+}
+
+BoundingBox& BoundingBox::pad(double margin) {
+  min = min - Vector3(margin, margin, margin);
+  max = max + Vector3(margin, margin, margin);
+  return *this;
+}
+
+bool BoundingBox::is_empty() const {
+  return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+Point3 BoundingBox::centroid() const {
+  return (min + max) * 0.5;
+}
+
+Vector3 BoundingBox::extent() const {
+  return Vector3(min, max);
+}
+
+double BoundingBox::surface_area() const {
+  if (is_empty()) {
+    return 0.0;
+  }
+  Vector3 size = extent();
+  return 2.0 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+int BoundingBox::largest_axis() const {
+  Vector3 size = extent();
+  if (size.x >= size.y && size.x >= size.z) {
+    return 0;
+  }
+  return size.y >= size.z ? 1 : 2;
+}
+
+bool BoundingBox::is_intersecting(const Rayon& ray, const Vector3& inv_direction, double t_max) const {
+  //The slabs of an empty box would cover all of space once ordered, boxes are empty along every axis or none
+  if (min.x > max.x) {
+    return false;
+  }
+  double tx0 = (min.x - ray.origin.x) * inv_direction.x;
+  double tx1 = (max.x - ray.origin.x) * inv_direction.x;
+  double t_enter = std::min(tx0, tx1);
+  double t_exit = std::max(tx0, tx1);
+
+  double ty0 = (min.y - ray.origin.y) * inv_direction.y;
+  double ty1 = (max.y - ray.origin.y) * inv_direction.y;
+  t_enter = std::max(t_enter, std::min(ty0, ty1));
+  t_exit = std::min(t_exit, std::max(ty0, ty1));
+
+  double tz0 = (min.z - ray.origin.z) * inv_direction.z;
+  double tz1 = (max.z - ray.origin.z) * inv_direction.z;
+  t_enter = std::max(t_enter, std::min(tz0, tz1));
+  t_exit = std::min(t_exit, std::max(tz0, tz1));
+
+  //The box can be behind the origin of the ray (t_exit < 0) or further than the closest hit found so far
+  return t_exit >= std::max(t_enter, 0.0) && t_enter <= t_max;
+}
+
+bool BoundingBox::clip(const Rayon& ray, const Vector3& inv_direction, double& t_enter, double& t_exit) const {
+  if (min.x > max.x) {
+    return false;
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    double t0 = (min[axis] - ray.origin[axis]) * inv_direction[axis];
+    double t1 = (max[axis] - ray.origin[axis]) * inv_direction[axis];
+    t_enter = std::max(t_enter, std::min(t0, t1));
+    t_exit = std::min(t_exit, std::max(t0, t1));
+  }
+  return t_enter <= t_exit;
+}
+
+Mask4 BoundingBox::is_intersecting(const RayPacket& packet, Double4 t_max) const {
+  if (min.x > max.x) {
+    return Double4(1.0) < Double4(0.0); //No lane
+  }
+  Double4 tx0 = (Double4(min.x) - packet.origin.x) * packet.inv_direction.x;
+  Double4 tx1 = (Double4(max.x) - packet.origin.x) * packet.inv_direction.x;
+  Double4 t_enter = ::min(tx0, tx1);
+  Double4 t_exit = ::max(tx0, tx1);
+
+  Double4 ty0 = (Double4(min.y) - packet.origin.y) * packet.inv_direction.y;
+  Double4 ty1 = (Double4(max.y) - packet.origin.y) * packet.inv_direction.y;
+  t_enter = ::max(t_enter, ::min(ty0, ty1));
+  t_exit = ::min(t_exit, ::max(ty0, ty1));
+
+  Double4 tz0 = (Double4(min.z) - packet.origin.z) * packet.inv_direction.z;
+  Double4 tz1 = (Double4(max.z) - packet.origin.z) * packet.inv_direction.z;
+  t_enter = ::max(t_enter, ::min(tz0, tz1));
+  t_exit = ::min(t_exit, ::max(tz0, tz1));
+
+  return (t_exit >= ::max(t_enter, Double4(0.0))) & (t_enter <= t_max);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Vector3.hh"
+#include "Rayon.hh"
+#include "RayPacket.hh"
+
+//Axis-aligned bounding box, an empty box has min > max on every axis
+class BoundingBox
+{
+public:
+  BoundingBox();
+  BoundingBox(Point3 min, Point3 max);
+
+  BoundingBox& expand(const Point3& point);
+  BoundingBox& expand(const BoundingBox& box);
+  BoundingBox& pad(double margin);
+
+  [[nodiscard]] bool is_empty() const;
+  [[nodiscard]] Point3 centroid() const;
+  [[nodiscard]] Vector3 extent() const;
+  [[nodiscard]] double surface_area() const;
+  [[nodiscard]] int largest_axis() const;
+
+  //Slab test, inv_direction is 1 / ray.direction computed once per ray by the caller
+  //Returns true if the ray enters the box with a t inferior to t_max
+  [[nodiscard]] bool is_intersecting(const Rayon& ray, const Vector3& inv_direction, double t_max) const;
+
+  //Narrows [t_enter, t_exit] to the part of the ray inside the box, returns false if nothing is left
+  bool clip(const Rayon& ray, const Vector3& inv_direction, double& t_enter, double& t_exit) const;
+
+  //Same test for the four rays of a packet, each lane has its own t_max
+  [[nodiscard]] Mask4 is_intersecting(const RayPacket& packet, Double4 t_max) const;
+
+  Point3 min;
+  Point3 max;
+};
@@ -18,7 +18,8 @@ std::vector<Point3> Camera::pixels_location(int width, int heigth) {
   //converted beforehand
   float half_image_plane_width = zmin * std::tan(alpha);
   Point3 first_pixel = half_image_plane_height * up - half_image_plane_width * side + center_image_plane;
-  std::vector<Point3> pixels_location{first_pixel};
+  std::vector<Point3> pixels_location;
+  pixels_location.reserve(width * heigth);
 
   float unit_x = (half_image_plane_width / (float)width) * 2.0;
   float unit_y = (half_image_plane_height / (float)heigth) * 2.0;
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "HdrImage.hh"
+
+static bool is_little_endian() {
+  std::uint16_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+HdrImage::HdrImage(const Image& image) {
+  begin(image.width, image.height);
+  write_rows(image.pixels.data(), 0, image.height);
+}
+
+HdrImage::HdrImage(const std::string& filename) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::invalid_argument("Could not open file " + filename);
+  }
+  std::string magic;
+  double scale;
+  file >> magic >> width >> height >> scale;
+  if ((magic != "PF" && magic != "Pf") || !file || width <= 0 || height <= 0 || scale == 0) {
+    throw std::invalid_argument("Not a PFM file: " + filename);
+  }
+  file.get(); //Single whitespace before the samples
+  std::size_t samples_per_pixel = magic == "PF" ? 3 : 1;
+  //The bytes left bound the samples before they are allocated, divided so that a forged header cannot overflow
+  std::streampos start = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::size_t remaining = static_cast<std::size_t>(file.tellg() - start);
+  file.seekg(start);
+  if (static_cast<std::size_t>(width) > remaining / (samples_per_pixel * sizeof(float)) / height) {
+    throw std::invalid_argument("Truncated samples in " + filename);
+  }
+  std::vector<float> samples(static_cast<std::size_t>(width) * height * samples_per_pixel);
+  file.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(float));
+  if (!file) {
+    throw std::invalid_argument("Truncated samples in " + filename);
+  }
+  //A negative scale means little endian
+  if ((scale < 0) != is_little_endian()) {
+    for (float& sample : samples) {
+      unsigned char bytes[4];
+      std::memcpy(bytes, &sample, 4);
+      std::reverse(bytes, bytes + 4);
+      std::memcpy(&sample, bytes, 4);
+    }
+  }
+  //The rows are stored from the bottom
+  channels.resize(static_cast<std::size_t>(width) * height * 3);
+  std::size_t row_samples = width * samples_per_pixel;
+  for (int y = 0; y < height; ++y) {
+    const float* row = &samples[(height - 1 - y) * row_samples];
+    float* output = &channels[static_cast<std::size_t>(y) * width * 3];
+    for (int x = 0; x < width; ++x) {
+      for (int channel = 0; channel < 3; ++channel) {
+        output[3 * x + channel] = samples_per_pixel == 3 ? row[3 * x + channel] : row[x];
+      }
+    }
+  }
+}
+
+void HdrImage::begin(int width, int height) {
+  this->width = width;
+  this->height = height;
+  channels.assign(static_cast<std::size_t>(width) * height * 3, 0.0f);
+}
+
+void HdrImage::write_rows(const Pixel* pixels, int y_begin, int y_end) {
+  float* output = &channels[static_cast<std::size_t>(y_begin) * width * 3];
+  std::size_t count = static_cast<std::size_t>(y_end - y_begin) * width;
+  for (std::size_t i = 0; i < count; ++i) {
+    output[3 * i] = pixels[i].x;
+    output[3 * i + 1] = pixels[i].y;
+    output[3 * i + 2] = pixels[i].z;
+  }
+}
+
+void HdrImage::end() {}
+
+void HdrImage::save_as_pfm(const std::string& filename) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::invalid_argument("Could not open file " + filename);
+  }
+  file << "PF\n" << width << " " << height << '\n' << (is_little_endian() ? "-1.0" : "1.0") << '\n';
+  std::size_t row_floats = static_cast<std::size_t>(width) * 3;
+  for (int y = height - 1; y >= 0; --y) {
+    file.write(reinterpret_cast<const char*>(&channels[y * row_floats]), row_floats * sizeof(float));
+  }
+}
+
+std::vector<unsigned char> HdrImage::tone_map(const ToneMapper& tone_mapper) const {
+  std::vector<unsigned char> output(channels.size());
+  tone_mapper.map(channels.data(), output.data(), channels.size());
+  return output;
+}
+
+void HdrImage::save_as_ppm(const std::string& filename, const ToneMapper& tone_mapper) const {
+  std::ofstream file(filename, std::ios::binary);
+  if (!file.is_open()) {
+    throw std::invalid_argument("Could not open file " + filename);
+  }
+  std::vector<unsigned char> output = tone_map(tone_mapper);
+  file << "P6\n" << width << " " << height << '\n' << 255 << '\n';
+  file.write(reinterpret_cast<const char*>(output.data()), output.size());
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Image.hh"
+#include "ImageSink.hh"
+#include "ToneMapper.hh"
+
+//Linear colors of a render in float32, it can be passed to Scene::raycasting as a sink and tone mapped again as many
+//times as needed without tracing the scene again
+class HdrImage : public ImageSink
+{
+public:
+  HdrImage() = default;
+  explicit HdrImage(const Image& image);
+  //Color or grey PFM of either endianness, throws std::invalid_argument if it is malformed
+  explicit HdrImage(const std::string& filename);
+
+  void begin(int width, int height) override;
+  void write_rows(const Pixel* pixels, int y_begin, int y_end) override;
+  void end() override;
+
+  //Little endian PFM, throws std::invalid_argument if the file cannot be created
+  void save_as_pfm(const std::string& filename) const;
+
+  //8 bit channels, three per pixel, through a single pass of tone_mapper over the whole buffer
+  [[nodiscard]] std::vector<unsigned char> tone_map(const ToneMapper& tone_mapper) const;
+  void save_as_ppm(const std::string& filename, const ToneMapper& tone_mapper) const;
+
+  int width = 0;
+  int height = 0;
+  std::vector<float> channels; //Three per pixel, row by row from the top
+};
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "Heightfield.hh"
+#include "BVH.hh"
+#include "Noise.hh"
+
+static void check_resolution(int resolution) {
+  if (resolution <= 0 || (resolution & (resolution - 1)) != 0) {
+    throw std::invalid_argument("Heightfield: the resolution has to be a power of two");
+  }
+}
+
+Heightfield::Heightfield(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size,
+                         int resolution, const std::function<double(double x, double y)>& height)
+    : Object{std::move(texture_material)}
+    , origin(origin)
+    , size(size)
+    , resolution(resolution)
+    , cell_size(size / resolution)
+{
+  check_resolution(resolution);
+  int points = resolution + 1;
+  heights.resize(points * points);
+  for (int y = 0; y < points; ++y) {
+    for (int x = 0; x < points; ++x) {
+      heights[y * points + x] = origin.z + height(origin.x + x * cell_size, origin.y + y * cell_size);
+    }
+  }
+  build_pyramid();
+}
+
+Heightfield::Heightfield(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size,
+                         int resolution, std::vector<float> samples)
+    : Object{std::move(texture_material)}
+    , origin(origin)
+    , size(size)
+    , resolution(resolution)
+    , cell_size(size / resolution)
+    , heights(std::move(samples))
+{
+  check_resolution(resolution);
+  if (heights.size() != static_cast<std::size_t>(resolution + 1) * (resolution + 1)) {
+    throw std::invalid_argument("Heightfield: expected (resolution + 1)^2 samples");
+  }
+  for (float& height : heights) {
+    height += origin.z;
+  }
+  build_pyramid();
+}
+
+void Heightfield::build_pyramid() {
+  min_heights.emplace_back(resolution * resolution);
+  max_heights.emplace_back(resolution * resolution);
+  for (int y = 0; y < resolution; ++y) {
+    for (int x = 0; x < resolution; ++x) {
+      auto corners = {height_at(x, y), height_at(x + 1, y), height_at(x, y + 1), height_at(x + 1, y + 1)};
+      min_heights[0][y * resolution + x] = std::min(corners);
+      max_heights[0][y * resolution + x] = std::max(corners);
+    }
+  }
+  for (int level_size = resolution / 2; level_size >= 1; level_size /= 2) {
+    const std::vector<float>& finer_min = min_heights.back();
+    const std::vector<float>& finer_max = max_heights.back();
+    std::vector<float> level_min(level_size * level_size);
+    std::vector<float> level_max(level_size * level_size);
+    for (int y = 0; y < level_size; ++y) {
+      for (int x = 0; x < level_size; ++x) {
+        int child = 2 * y * 2 * level_size + 2 * x;
+        int next_row = 2 * level_size;
+        level_min[y * level_size + x] = std::min({finer_min[child], finer_min[child + 1], finer_min[child + next_row],
+                                                  finer_min[child + next_row + 1]});
+        level_max[y * level_size + x] = std::max({finer_max[child], finer_max[child + 1], finer_max[child + next_row],
+                                                  finer_max[child + next_row + 1]});
+      }
+    }
+    min_heights.push_back(std::move(level_min));
+    max_heights.push_back(std::move(level_max));
+  }
+}
+
+double Heightfield::height_at(int x, int y) const {
+  return heights[y * (resolution + 1) + x];
+}
+
+std::optional<HitRecord> Heightfield::is_intersecting(const Rayon& ray) const {
+  return find_nearest(ray, epsilon, std::numeric_limits<double>::infinity());
+}
+
+std::optional<HitRecord> Heightfield::find_nearest(const Rayon& ray, double t_min, double t_max) const {
+  return traverse(ray, t_min, t_max, false);
+}
+
+bool Heightfield::is_occluding(const Rayon& ray, double t_min, double t_max) const {
+  return traverse(ray, t_min, t_max, true).has_value();
+}
+
+std::optional<HitRecord> Heightfield::traverse(const Rayon& ray, double t_min, double t_max, bool any_hit) const {
+  struct Node
+  {
+    int level;
+    int x;
+    int y;
+  };
+  Vector3 inv_direction = inverse_direction(ray.direction);
+  //The closest children are pushed last so that they are visited first
+  int first_x = ray.direction.x < 0 ? 1 : 0;
+  int first_y = ray.direction.y < 0 ? 1 : 0;
+  const int child_order[4][2] = {{1 - first_x, 1 - first_y}, {1 - first_x, first_y}, {first_x, 1 - first_y},
+                                 {first_x, first_y}};
+  Node stack[128]; //3 siblings left per level at most
+  int stack_size = 0;
+  stack[stack_size++] = {static_cast<int>(min_heights.size()) - 1, 0, 0};
+  std::optional<HitRecord> closest;
+  double t_closest = t_max;
+  while (stack_size > 0) {
+    Node node = stack[--stack_size];
+    int level_size = resolution >> node.level;
+    int index = node.y * level_size + node.x;
+    double node_size = cell_size * (1 << node.level);
+    BoundingBox box(Point3(origin.x + node.x * node_size, origin.y + node.y * node_size, min_heights[node.level][index]),
+                    Point3(origin.x + (node.x + 1) * node_size, origin.y + (node.y + 1) * node_size,
+                           max_heights[node.level][index]));
+    box.pad(epsilon);
+    double t_enter = t_min;
+    double t_exit = t_closest;
+    if (!box.clip(ray, inv_direction, t_enter, t_exit)) {
+      continue;
+    }
+    if (node.level > 0) {
+      for (const auto& child : child_order) {
+        stack[stack_size++] = {node.level - 1, 2 * node.x + child[0], 2 * node.y + child[1]};
+      }
+      continue;
+    }
+    //Cell split along its diagonal from (x, y) to (x + 1, y + 1)
+    Point3 A(origin.x + node.x * cell_size, origin.y + node.y * cell_size, height_at(node.x, node.y));
+    Point3 B(A.x + cell_size, A.y, height_at(node.x + 1, node.y));
+    Point3 C(A.x + cell_size, A.y + cell_size, height_at(node.x + 1, node.y + 1));
+    Point3 D(A.x, A.y + cell_size, height_at(node.x, node.y + 1));
+    Vector3 AC(A, C);
+    const Point3* second[2] = {&B, &C};
+    const Point3* third[2] = {&C, &D};
+    for (int triangle = 0; triangle < 2; ++triangle) {
+      auto hit = intersect_triangle(A, Vector3(A, *second[triangle]), Vector3(A, *third[triangle]), ray, t_min,
+                                    t_closest, epsilon);
+      if (hit) {
+        hit->primitive_id = 2 * index + triangle;
+        t_closest = hit->t;
+        closest = hit;
+        if (any_hit) {
+          return closest;
+        }
+      }
+    }
+  }
+  return closest;
+}
+
+Vector3 Heightfield::grid_normal(int x, int y) const {
+  int left = std::max(x - 1, 0);
+  int right = std::min(x + 1, resolution);
+  int down = std::max(y - 1, 0);
+  int up = std::min(y + 1, resolution);
+  double slope_x = (height_at(right, y) - height_at(left, y)) / ((right - left) * cell_size);
+  double slope_y = (height_at(x, up) - height_at(x, down)) / ((up - down) * cell_size);
+  return Vector3(-slope_x, -slope_y, 1).normalize();
+}
+
+//u weights the second corner and v the third one, like for the other triangles
+Vector3 Heightfield::normal_at_point(const HitRecord& hit, const Point3&, const Rayon& ray) const {
+  int cell = hit.primitive_id / 2;
+  int x = cell % resolution;
+  int y = cell / resolution;
+  Vector3 second = hit.primitive_id % 2 == 0 ? grid_normal(x + 1, y) : grid_normal(x + 1, y + 1);
+  Vector3 third = hit.primitive_id % 2 == 0 ? grid_normal(x + 1, y + 1) : grid_normal(x, y + 1);
+  double w = 1.0 - hit.u - hit.v;
+  Vector3 normal = w * grid_normal(x, y) + hit.u * second + hit.v * third;
+  if (ray.direction.scalar_product(normal) > 0) {
+    return -1.0 * normal;
+  }
+  return normal;
+}
+
+Caracteristics Heightfield::texture_at_point(const HitRecord&, const Point3& point) const {
+  return texture_material->caracteristics_solid(point);
+}
+
+std::optional<BoundingBox> Heightfield::bounding_box() const {
+  return BoundingBox(Point3(origin.x, origin.y, min_heights.back()[0]),
+                     Point3(origin.x + size, origin.y + size, max_heights.back()[0])).pad(epsilon);
+}
+
+std::shared_ptr<Heightfield> perlin_sea(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size,
+                                        int resolution, double amplitude, double wavelength, int octaves,
+                                        std::uint32_t seed) {
+  check_resolution(resolution);
+  GradientNoise noise(seed);
+  int points = resolution + 1;
+  double cell_size = size / resolution;
+  //A whole row of samples at a time through the batch fbm
+  std::vector<double> row_x(points);
+  std::vector<double> row_y(points);
+  std::vector<double> row_heights(points);
+  for (int x = 0; x < points; ++x) {
+    row_x[x] = (origin.x + x * cell_size) / wavelength;
+  }
+  std::vector<float> samples(points * points);
+  for (int y = 0; y < points; ++y) {
+    std::fill(row_y.begin(), row_y.end(), (origin.y + y * cell_size) / wavelength);
+    noise.fbm(NoiseBasis::perlin, row_x.data(), row_y.data(), row_heights.data(), points, Fractal{octaves});
+    for (int x = 0; x < points; ++x) {
+      samples[y * points + x] = amplitude * row_heights[x];
+    }
+  }
+  return std::make_shared<Heightfield>(std::move(texture_material), origin, size, resolution, std::move(samples));
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "Object.hh"
+
+//Surface z = height(x, y) over the square [origin.x, origin.x + size] x [origin.y, origin.y + size], sampled on a
+//grid of resolution x resolution cells, each cell being made of two triangles that are never stored
+//The rays walk a quadtree of the minimum and maximum heights of the cells, front to back, so only the cells along
+//the ray near the surface are tested
+class Heightfield : public Object {
+public:
+  //resolution has to be a power of two, throws std::invalid_argument otherwise
+  Heightfield(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size, int resolution,
+              const std::function<double(double x, double y)>& height);
+
+  //Same from heights already sampled, (resolution + 1)^2 of them row by row, relative to origin.z
+  Heightfield(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size, int resolution,
+              std::vector<float> samples);
+
+  std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+  std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+  bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
+
+  //Interpolated from the normals of the grid points, computed from the slopes of the heights around them
+  Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
+
+  Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
+
+  std::optional<BoundingBox> bounding_box() const override;
+
+  [[nodiscard]] double height_at(int x, int y) const;
+
+  Point3 origin;
+  double size;
+  int resolution;
+  double cell_size;
+  std::vector<float> heights; //(resolution + 1)^2 samples, row by row along y
+
+private:
+  //Nearest hit, or the first one found when any_hit is set
+  std::optional<HitRecord> traverse(const Rayon& ray, double t_min, double t_max, bool any_hit) const;
+
+  [[nodiscard]] Vector3 grid_normal(int x, int y) const;
+
+  void build_pyramid();
+
+  //Level 0 holds the cells, level l the blocks of 2^l x 2^l cells, the last level is the whole heightfield
+  std::vector<std::vector<float>> min_heights;
+  std::vector<std::vector<float>> max_heights;
+};
+
+//Sea surface made of octaves of Perlin noise, amplitude is the height of the first octave and wavelength its period
+std::shared_ptr<Heightfield> perlin_sea(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double size,
+                                        int resolution, double amplitude, double wavelength, int octaves,
+                                        std::uint32_t seed = 0);
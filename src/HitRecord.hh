@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+//Result of an intersection test, it carries everything the shading of the hit needs so that objects do not have to
+//remember anything about the last ray they were tested against
+struct HitRecord
+{
+  double t = 0;
+  double u = 0; //Barycentric coordinates of the hit relative to B and C for triangles, the weight of A is 1 - u - v
+  double v = 0;
+  std::uint32_t primitive_id = 0; //Which primitive was hit for objects made of several ones
+  double footprint = 0; //Width of the ray cone at the hit, for the textures to filter over
+};
@@ -1,57 +1,191 @@
 #include "Image.hh"
+#include "ImageSink.hh"
+#include <algorithm>
+#include <cctype>
 #include <iostream>
+#include <iterator>
 #include <fstream>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 Image::Image(int width, int height)
 : width(width)
 , height(height) {}
 
-  Image::Image(const std::string& input_filename) {
-  std::ifstream file;
-  file.open(input_filename);
-  if (!file.is_open()) {
-    throw std::invalid_argument("Could not open file " + input_filename);
+//Read only view of a whole file, mapped in memory where the system allows it and read in one go otherwise
+class FileView
+{
+public:
+  explicit FileView(const std::string& filename) {
+#if defined(__unix__) || defined(__APPLE__)
+    int descriptor = open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      throw std::invalid_argument("Could not open file " + filename);
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+      size = status.st_size;
+      void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+      if (mapping != MAP_FAILED) {
+        data = static_cast<const unsigned char*>(mapping);
+        mapped = true;
+      }
+    }
+    close(descriptor);
+    if (mapped || size == 0) {
+      return;
+    }
+#endif
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+      throw std::invalid_argument("Could not open file " + filename);
+    }
+    copy.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = reinterpret_cast<const unsigned char*>(copy.data());
+    size = copy.size();
   }
 
-  std::string tmp;
-  file >> tmp;
-  if (tmp != "P3" && tmp != "P6") {
-    std::cout << tmp << '\n';
-    throw std::invalid_argument("Not P3 or P6 it is " + tmp);
+  ~FileView() {
+#if defined(__unix__) || defined(__APPLE__)
+    if (mapped) {
+      munmap(const_cast<unsigned char*>(data), size);
+    }
+#endif
+  }
+
+  FileView(const FileView&) = delete;
+  FileView& operator=(const FileView&) = delete;
+
+  const unsigned char* data = nullptr;
+  std::size_t size = 0;
+
+private:
+  bool mapped = false;
+  std::string copy;
+};
+
+//Reads the fields of a netpbm file, the whitespace and the comments between them are skipped
+class PnmScanner
+{
+public:
+  PnmScanner(const unsigned char* data, std::size_t size, const std::string& filename)
+      : current(data)
+      , end(data + size)
+      , filename(filename) {}
+
+  int read_integer() {
+    skip_separators();
+    if (current == end || *current < '0' || *current > '9') {
+      throw std::invalid_argument("Expected a number in " + filename);
+    }
+    long long value = 0;
+    while (current != end && *current >= '0' && *current <= '9') {
+      value = value * 10 + (*current++ - '0');
+      if (value > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("Number too large in " + filename);
+      }
+    }
+    return static_cast<int>(value);
+  }
+
+  void skip_separators() {
+    while (current != end) {
+      if (*current == '#') {
+        while (current != end && *current != '\n') {
+          ++current;
+        }
+      } else if (std::isspace(*current)) {
+        ++current;
+      } else {
+        return;
+      }
+    }
+  }
+
+  const unsigned char* current;
+  const unsigned char* end;
+
+private:
+  const std::string& filename;
+};
+
+Image::Image(const std::string& input_filename) {
+  FileView file(input_filename);
+  if (file.size < 2 || file.data[0] != 'P' || (file.data[1] != '3' && file.data[1] != '6')) {
+    throw std::invalid_argument("Not P3 or P6: " + input_filename);
+  }
+  bool binary = file.data[1] == '6';
+  PnmScanner scanner(file.data + 2, file.size - 2, input_filename);
+  width = scanner.read_integer();
+  height = scanner.read_integer();
+  max_color_value = scanner.read_integer();
+  if (width <= 0 || height <= 0 || max_color_value <= 0 || max_color_value > 65535) {
+    throw std::invalid_argument("Invalid header in " + input_filename);
   }
-  file >> width;
-  file >> height;
-  file >> max_color_value;
   std::cout << "Width : " << width << " Height : " << height << " Max color value : " << max_color_value << '\n';
-  file.ignore(256, '\n');
-  for (int i = 0; i < width * height; ++i) {
-    unsigned char buffer[3];
-    file.read(reinterpret_cast<char *>(buffer), 3);
-    pixels.emplace_back(buffer[0], buffer[1], buffer[2]);
+  if (static_cast<std::size_t>(width) > std::numeric_limits<std::size_t>::max() / 6 / height) {
+    throw std::invalid_argument("Invalid header in " + input_filename);
+  }
+  std::size_t count = static_cast<std::size_t>(width) * height;
+
+  //The size of the file bounds the pixels before they are allocated, a forged header cannot ask for more
+  //The channels keep their values in [0, max_color_value]
+  if (!binary) {
+    //A text sample takes at least a digit and a separator, the last one can end the file
+    if (count > (static_cast<std::size_t>(scanner.end - scanner.current) + 1) / 6) {
+      throw std::invalid_argument("Truncated samples in " + input_filename);
+    }
+    pixels.resize(count);
+    for (auto& pixel : pixels) {
+      pixel.x = scanner.read_integer();
+      pixel.y = scanner.read_integer();
+      pixel.z = scanner.read_integer();
+    }
+    return;
+  }
+  //A single whitespace separates the header from the samples, two bytes big endian per sample past 255
+  if (scanner.current == scanner.end) {
+    throw std::invalid_argument("Truncated samples in " + input_filename);
+  }
+  ++scanner.current;
+  std::size_t sample_size = max_color_value < 256 ? 1 : 2;
+  if (static_cast<std::size_t>(scanner.end - scanner.current) < 3 * count * sample_size) {
+    throw std::invalid_argument("Truncated samples in " + input_filename);
+  }
+  pixels.resize(count);
+  const unsigned char* samples = scanner.current;
+  if (sample_size == 1) {
+    for (std::size_t i = 0; i < count; ++i, samples += 3) {
+      pixels[i] = Pixel(samples[0], samples[1], samples[2]);
+    }
+  } else {
+    for (std::size_t i = 0; i < count; ++i, samples += 6) {
+      pixels[i] = Pixel((samples[0] << 8) | samples[1], (samples[2] << 8) | samples[3], (samples[4] << 8) | samples[5]);
+    }
   }
-  file.close();
 }
 
 unsigned char Image::compress_value(double value) {
+  return compress_value(value, gamma);
+}
+
+unsigned char Image::compress_value(double value, double gamma) {
   return (unsigned char)(std::max(0.0, std::min(255.0, std::pow(value, 1/gamma))));
 }
 
 void Image::save_as_ppm(const std::string& filename) {
-    std::ofstream file;
-    file.open(filename);
-    file << "P6\n";
-    file << width << " " << height << '\n';
-    file << max_color_value << '\n';
-    for (const auto& pixel : pixels) {
-      unsigned char r = compress_value(pixel.x);
-      unsigned char g = compress_value(pixel.y);
-      unsigned char b = compress_value(pixel.z);
-      file << r << g << b;
-    }
-    file.close();
+  constexpr int band_rows = 64;
+  PpmSink sink(filename, gamma);
+  sink.begin(width, height);
+  for (int y = 0; y < height; y += band_rows) {
+    sink.write_rows(&pixels[static_cast<std::size_t>(y) * width], y, std::min(y + band_rows, height));
+  }
+  sink.end();
 }
-
-
-
-
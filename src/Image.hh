@@ -7,9 +7,14 @@ class Image
 {
  public:
   Image(int width, int height);
+  //P3 or P6 file, the channels keep their values in [0, max_color_value]
+  //A P6 file is memory mapped and decoded straight into pixels, throws std::invalid_argument if it is malformed
   Image(const std::string& input_filename);
 
   unsigned char compress_value(double value);
+  //Gamma corrected channel, clamped to [0, 255]
+  static unsigned char compress_value(double value, double gamma);
+  //Encoded through a PpmSink by bands of rows
   void save_as_ppm(const std::string& filename);
 
   int width;
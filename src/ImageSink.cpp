@@ -0,0 +1,37 @@
+#include <stdexcept>
+
+#include "ImageSink.hh"
+
+PpmSink::PpmSink(const std::string& filename, double gamma)
+    : tone_mapper(gamma)
+    , file(filename, std::ios::binary)
+{
+  if (!file.is_open()) {
+    throw std::invalid_argument("Could not open file " + filename);
+  }
+}
+
+void PpmSink::begin(int width, int height) {
+  this->width = width;
+  file << "P6\n" << width << " " << height << "\n255\n";
+}
+
+void PpmSink::write_rows(const Pixel* pixels, int y_begin, int y_end) {
+  std::size_t count = static_cast<std::size_t>(y_end - y_begin) * width;
+  buffer.resize(3 * count);
+  char* output = buffer.data();
+  for (std::size_t i = 0; i < count; ++i) {
+    *output++ = tone_mapper.map(pixels[i].x);
+    *output++ = tone_mapper.map(pixels[i].y);
+    *output++ = tone_mapper.map(pixels[i].z);
+  }
+  file.write(buffer.data(), buffer.size());
+  file.flush();
+  if (!file) {
+    throw std::invalid_argument("Could not write rows " + std::to_string(y_begin) + " to " + std::to_string(y_end));
+  }
+}
+
+void PpmSink::end() {
+  file.close();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Vector3.hh"
+#include "ToneMapper.hh"
+
+//Receives an image band by band while it is rendered, the bands are complete rows given from top to bottom
+class ImageSink
+{
+public:
+  virtual ~ImageSink() = default;
+
+  virtual void begin(int width, int height) = 0;
+
+  //Rows [y_begin, y_end) of the image, pixels points to the first pixel of row y_begin
+  virtual void write_rows(const Pixel* pixels, int y_begin, int y_end) = 0;
+
+  virtual void end() = 0;
+};
+
+//P6 file written as the bands arrive, each band is encoded in one buffer and handed to the system with a single
+//write, so a render that stops early leaves the rows done so far on disk
+//The tone mapper gives one byte per channel, so the maximum color value of the file is always 255
+class PpmSink : public ImageSink
+{
+public:
+  //Throws std::invalid_argument if the file cannot be created
+  explicit PpmSink(const std::string& filename, double gamma = 2.2);
+
+  void begin(int width, int height) override;
+  //Throws std::invalid_argument if the rows could not be written
+  void write_rows(const Pixel* pixels, int y_begin, int y_end) override;
+  void end() override;
+
+  ToneMapper tone_mapper; //Of the gamma given to the constructor
+
+private:
+  std::ofstream file;
+  std::vector<char> buffer;
+  int width = 0;
+};
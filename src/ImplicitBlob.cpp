@@ -0,0 +1,126 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "ImplicitBlob.hh"
+#include "BVH.hh"
+#include "Simd.hh"
+
+ImplicitBlob::ImplicitBlob(std::shared_ptr<Texture_Material> texture_material, std::vector<Point3> blobs_origin,
+                           double threshold)
+    : Object{std::move(texture_material)}
+    , blobs_origin(std::move(blobs_origin))
+    , threshold(threshold)
+{
+  //Farther than sqrt(N / threshold) from every center the N terms of the field add up to less than the threshold
+  double radius = std::sqrt(this->blobs_origin.size() / threshold);
+  for (const auto& origin : this->blobs_origin) {
+    box.expand(origin);
+  }
+  if (!box.is_empty()) {
+    box.pad(radius);
+  }
+  //An infinitely far center adds nothing to the field and is never the closest one
+  std::size_t padded = (this->blobs_origin.size() + 3) / 4 * 4;
+  centers_x.assign(padded, std::numeric_limits<double>::infinity());
+  centers_y.assign(padded, std::numeric_limits<double>::infinity());
+  centers_z.assign(padded, std::numeric_limits<double>::infinity());
+  for (std::size_t i = 0; i < this->blobs_origin.size(); ++i) {
+    centers_x[i] = this->blobs_origin[i].x;
+    centers_y[i] = this->blobs_origin[i].y;
+    centers_z[i] = this->blobs_origin[i].z;
+  }
+}
+
+ImplicitBlob::ImplicitBlob(const Blob& blob)
+    : ImplicitBlob(blob.texture_material, blob.blobs_origin, blob.threshold)
+{
+  if (blob.kernel != BlobKernel::inverse_square) {
+    throw std::invalid_argument("ImplicitBlob: the step bound only holds for the inverse square kernel");
+  }
+}
+
+double ImplicitBlob::potential(const Point3& point, double& closest_distance) const {
+  Double4 point_x(point.x);
+  Double4 point_y(point.y);
+  Double4 point_z(point.z);
+  Double4 value;
+  Double4 closest_squared(std::numeric_limits<double>::infinity());
+  for (std::size_t i = 0; i < centers_x.size(); i += 4) {
+    Double4 distance_x = point_x - Double4::load(&centers_x[i]);
+    Double4 distance_y = point_y - Double4::load(&centers_y[i]);
+    Double4 distance_z = point_z - Double4::load(&centers_z[i]);
+    Double4 squared = distance_x * distance_x + distance_y * distance_y + distance_z * distance_z;
+    closest_squared = min(closest_squared, squared);
+    value = value + Double4(1.0) / squared;
+  }
+  closest_distance = std::sqrt(std::min(std::min(closest_squared[0], closest_squared[1]),
+                                        std::min(closest_squared[2], closest_squared[3])));
+  return (value[0] + value[1]) + (value[2] + value[3]);
+}
+
+Vector3 ImplicitBlob::gradient(const Point3& point) const {
+  Vector3 gradient;
+  for (const auto& origin : blobs_origin) {
+    Vector3 distance(origin, point);
+    double squared = distance.scalar_product(distance);
+    gradient += distance * (-2.0 / (squared * squared));
+  }
+  return gradient;
+}
+
+std::optional<HitRecord> ImplicitBlob::is_intersecting(const Rayon& ray) const {
+  return find_nearest(ray, epsilon, std::numeric_limits<double>::infinity());
+}
+
+//Moving by s changes the distance to each center by at most s, so with r the distance to the closest center every
+//term is multiplied by at most (r / (r - s))^2 and at least (r / (r + s))^2
+//Outside the field stays under the threshold for s < r (1 - sqrt(potential / threshold))
+//and inside above it for s < r (sqrt(potential / threshold) - 1)
+std::optional<HitRecord> ImplicitBlob::find_nearest(const Rayon& ray, double t_min, double t_max) const {
+  double t = t_min;
+  double t_exit = t_max;
+  if (!box.clip(ray, inverse_direction(ray.direction), t, t_exit)) {
+    return std::optional<HitRecord>();
+  }
+  double direction_norm = ray.direction.norm();
+  //A ray starting on the surface, like the rays leaving it, first has to get away from it
+  bool leaving_surface = true;
+  for (int step = 0; step < max_steps && t < t_exit; ++step) {
+    double closest_distance;
+    double value = potential(ray.origin + ray.direction * t, closest_distance);
+    double safe_distance = closest_distance * std::fabs(1.0 - std::sqrt(value / threshold));
+    if (safe_distance < epsilon) {
+      if (leaving_surface) {
+        t += epsilon / direction_norm;
+        continue;
+      }
+      return HitRecord{t};
+    }
+    leaving_surface = false;
+    t += safe_distance / direction_norm;
+  }
+  return std::optional<HitRecord>();
+}
+
+bool ImplicitBlob::is_occluding(const Rayon& ray, double t_min, double t_max) const {
+  return find_nearest(ray, t_min, t_max).has_value();
+}
+
+//The field decreases when going out of the blob
+Vector3 ImplicitBlob::normal_at_point(const HitRecord&, const Point3& point, const Rayon& ray) const {
+  Vector3 normal = (-gradient(point)).normalize();
+  if (ray.direction.scalar_product(normal) > 0) {
+    return -1.0 * normal;
+  }
+  return normal;
+}
+
+Caracteristics ImplicitBlob::texture_at_point(const HitRecord&, const Point3& point) const {
+  return texture_material->caracteristics_solid(point);
+}
+
+std::optional<BoundingBox> ImplicitBlob::bounding_box() const {
+  return box;
+}
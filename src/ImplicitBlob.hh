@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "Blob.hh"
+#include "Object.hh"
+
+//Iso surface potential = threshold of the blob field, rendered by marching along the rays without triangulation
+//The steps come from a bound on the field between the ray and the centers so they never cross the surface,
+//the normals from the analytic gradient of the field
+class ImplicitBlob : public Object {
+public:
+  ImplicitBlob(std::shared_ptr<Texture_Material> texture_material, std::vector<Point3> blobs_origin, double threshold);
+  //Only for blobs with the inverse square kernel, throws std::invalid_argument otherwise
+  explicit ImplicitBlob(const Blob& blob);
+
+  std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+  std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+  bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
+
+  Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
+
+  Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
+
+  std::optional<BoundingBox> bounding_box() const override;
+
+  //Same field as Blob::potential, also gives the distance to the closest center
+  double potential(const Point3& point, double& closest_distance) const;
+
+  Vector3 gradient(const Point3& point) const;
+
+  std::vector<Point3> blobs_origin;
+  double threshold;
+  int max_steps = 1000; //A ray still marching after that many steps is considered as missing the blob
+
+private:
+  BoundingBox box;
+  //Coordinates of the centers for the four lane loop of potential, padded with far away centers
+  std::vector<double> centers_x;
+  std::vector<double> centers_y;
+  std::vector<double> centers_z;
+};
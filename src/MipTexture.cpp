@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MipTexture.hh"
+
+static constexpr int tile_bits = 3;
+static constexpr int tile_size = 1 << tile_bits;
+
+//Index of a texel in its tile from x + y * tile_size, the bits of the coordinates interleaved
+struct MortonTable
+{
+  constexpr MortonTable() {
+    for (int y = 0; y < tile_size; ++y) {
+      for (int x = 0; x < tile_size; ++x) {
+        unsigned char index = 0;
+        for (int bit = 0; bit < tile_bits; ++bit) {
+          index |= ((x >> bit) & 1) << (2 * bit);
+          index |= ((y >> bit) & 1) << (2 * bit + 1);
+        }
+        indices[x + y * tile_size] = index;
+      }
+    }
+  }
+  unsigned char indices[tile_size * tile_size] = {};
+};
+static constexpr MortonTable morton;
+
+//Coordinate of a texel repeated in [0, size)
+static int wrap(double coordinate, int size) {
+  if (coordinate >= 0 && coordinate < size) {
+    return static_cast<int>(coordinate);
+  }
+  int wrapped = static_cast<int>(coordinate - std::floor(coordinate / size) * size);
+  return std::min(wrapped, size - 1);
+}
+
+MipTexture::MipTexture(const Image& image)
+    : width(image.width)
+    , height(image.height)
+    , scale(image.max_color_value / 255.0)
+{
+  //Box filtered levels down to a single texel, built in floats from the level above
+  std::vector<float> current(static_cast<std::size_t>(width) * height * 3);
+  std::size_t count = std::min(image.pixels.size(), current.size() / 3);
+  for (std::size_t i = 0; i < count; ++i) {
+    current[3 * i] = image.pixels[i].x / scale;
+    current[3 * i + 1] = image.pixels[i].y / scale;
+    current[3 * i + 2] = image.pixels[i].z / scale;
+  }
+  int level_width = width;
+  int level_height = height;
+  while (level_width > 0 && level_height > 0) {
+    Level level{level_width, level_height, (level_width + tile_size - 1) / tile_size, texels.size()};
+    int tiles_y = (level_height + tile_size - 1) / tile_size;
+    texels.resize(texels.size() + static_cast<std::size_t>(level.tiles_x) * tiles_y * tile_size * tile_size * 3);
+    levels.push_back(level);
+    for (int y = 0; y < level_height; ++y) {
+      for (int x = 0; x < level_width; ++x) {
+        unsigned char* output = &texels[texel_offset(level, x, y)];
+        for (int channel = 0; channel < 3; ++channel) {
+          float value = current[(static_cast<std::size_t>(y) * level_width + x) * 3 + channel];
+          output[channel] = static_cast<unsigned char>(std::clamp(value, 0.0f, 255.0f) + 0.5f);
+        }
+      }
+    }
+    if (level_width == 1 && level_height == 1) {
+      break;
+    }
+    int next_width = std::max(level_width / 2, 1);
+    int next_height = std::max(level_height / 2, 1);
+    std::vector<float> next(static_cast<std::size_t>(next_width) * next_height * 3);
+    for (int y = 0; y < next_height; ++y) {
+      int y0 = std::min(2 * y, level_height - 1);
+      int y1 = std::min(2 * y + 1, level_height - 1);
+      for (int x = 0; x < next_width; ++x) {
+        int x0 = std::min(2 * x, level_width - 1);
+        int x1 = std::min(2 * x + 1, level_width - 1);
+        for (int channel = 0; channel < 3; ++channel) {
+          auto at = [&](int sx, int sy) {
+            return current[(static_cast<std::size_t>(sy) * level_width + sx) * 3 + channel];
+          };
+          next[(static_cast<std::size_t>(y) * next_width + x) * 3 + channel] =
+              0.25f * (at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1));
+        }
+      }
+    }
+    current = std::move(next);
+    level_width = next_width;
+    level_height = next_height;
+  }
+}
+
+int MipTexture::level_count() const {
+  return static_cast<int>(levels.size());
+}
+
+std::size_t MipTexture::memory_bytes() const {
+  return texels.size() + levels.size() * sizeof(Level);
+}
+
+std::size_t MipTexture::texel_offset(const Level& level, int x, int y) const {
+  std::size_t tile = static_cast<std::size_t>(y >> tile_bits) * level.tiles_x + (x >> tile_bits);
+  int in_tile = (x & (tile_size - 1)) + (y & (tile_size - 1)) * tile_size;
+  std::size_t index = tile * tile_size * tile_size + morton.indices[in_tile];
+  return level.offset + index * 3;
+}
+
+Pixel MipTexture::bilinear(const Level& level, double u, double v) const {
+  //Texel centers are at half integers
+  double x = u * level.width - 0.5;
+  double y = v * level.height - 0.5;
+  double floor_x = std::floor(x);
+  double floor_y = std::floor(y);
+  double fx = x - floor_x;
+  double fy = y - floor_y;
+  int x0 = wrap(floor_x, level.width);
+  int y0 = wrap(floor_y, level.height);
+  int x1 = x0 + 1 == level.width ? 0 : x0 + 1;
+  int y1 = y0 + 1 == level.height ? 0 : y0 + 1;
+  const unsigned char* t00 = &texels[texel_offset(level, x0, y0)];
+  const unsigned char* t10 = &texels[texel_offset(level, x1, y0)];
+  const unsigned char* t01 = &texels[texel_offset(level, x0, y1)];
+  const unsigned char* t11 = &texels[texel_offset(level, x1, y1)];
+  double w00 = (1 - fx) * (1 - fy);
+  double w10 = fx * (1 - fy);
+  double w01 = (1 - fx) * fy;
+  double w11 = fx * fy;
+  auto channel = [&](int c) { return scale * (w00 * t00[c] + w10 * t10[c] + w01 * t01[c] + w11 * t11[c]); };
+  return Pixel(channel(0), channel(1), channel(2));
+}
+
+Pixel MipTexture::sample(double u, double v) const {
+  if (levels.empty()) {
+    return Pixel(0, 0, 0);
+  }
+  return bilinear(levels[0], u, v);
+}
+
+Pixel MipTexture::sample(double u, double v, double footprint) const {
+  if (levels.empty()) {
+    return Pixel(0, 0, 0);
+  }
+  //The level whose texels are as wide as the footprint
+  double lod = std::log2(std::max(1.0, footprint * std::max(width, height)));
+  lod = std::min(lod, static_cast<double>(levels.size() - 1));
+  int level = static_cast<int>(lod);
+  double blend = lod - level;
+  Pixel result = bilinear(levels[level], u, v);
+  if (blend > 0) {
+    result = result * (1 - blend) + bilinear(levels[level + 1], u, v) * blend;
+  }
+  return result;
+}
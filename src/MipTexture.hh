@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "Image.hh"
+
+//Mip levels of an image stored as 8 bit RGB texels, three bytes instead of the 24 of a Pixel
+//Each level is cut in tiles of 8x8 texels whose texels follow the Morton order, so the four texels of a bilinear
+//lookup are most often in the same 192 bytes
+//The coordinates repeat outside of [0, 1), v goes down the rows of the image like for Image_Texture
+class MipTexture
+{
+public:
+  MipTexture() = default;
+  //The channels of image are in [0, image.max_color_value] and keep this range in the lookups
+  explicit MipTexture(const Image& image);
+
+  //Bilinear lookup in the first level
+  [[nodiscard]] Pixel sample(double u, double v) const;
+  //Trilinear lookup between the two levels around footprint, the width in texture coordinates the lookup covers
+  [[nodiscard]] Pixel sample(double u, double v, double footprint) const;
+
+  [[nodiscard]] int level_count() const;
+  [[nodiscard]] std::size_t memory_bytes() const;
+
+  int width = 0;
+  int height = 0;
+
+private:
+  struct Level
+  {
+    int width;
+    int height;
+    int tiles_x;
+    std::size_t offset; //Of the first texel in texels
+  };
+
+  [[nodiscard]] Pixel bilinear(const Level& level, double u, double v) const;
+  //Of the first channel of a texel in texels
+  [[nodiscard]] std::size_t texel_offset(const Level& level, int x, int y) const;
+
+  std::vector<Level> levels;
+  std::vector<unsigned char> texels;
+  double scale = 1; //From a byte back to the range of the image
+};
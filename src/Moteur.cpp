@@ -223,9 +223,34 @@ void blob_test() {
   scene.add_light(light);
   std::cout << scene.raycast(Rayon(Vector3(1,0.1,0), center), scene.max_bounces);
   Image image = scene.raycasting();
+  std::cout << scene.shadow_statistics;
   image.save_as_ppm("images/blob.ppm");
 }
 
+//Two blobs crossing each other, only the bricks around them are remeshed from one frame to the next
+void blob_animation() {
+  Point3 center(0,0,0);
+  Point3 spotted_point(2,0,0);
+  Vector3 up(0,0,1);
+  Camera camera(center, spotted_point, up, 45.0, 45.0, 1.0);
+  Scene scene = Scene(camera, 2);
+  scene.threads = 0;
+  Caracteristics caracteristics_green(Pixel(0, 255, 0), 0.4, 0, 1);
+  Caracteristics caracteristics_blue(Pixel(0, 0, 255), 0.2, 0.5, 1);
+  std::vector<Point3> start = {Point3(4,1.2,1), Point3(4, -1.2, 1.2)};
+  Blob blob = Blob(Point3(4.5,0.2,-0.3), 12, 0.05, start, 0.3, std::make_shared<Uniform_Texture>(caracteristics_green));
+  blob.use_compact_kernel(1.5);
+  scene.add_object(std::make_shared<Plane>(std::make_shared<Uniform_Texture>(caracteristics_blue), Point3(5,0,0), Vector3(-1,0,0)));
+  scene.add_light(std::make_shared<Point_Light>(Point3(2,0,0), 1000));
+  Animation animation(scene);
+  animation.add_blob(blob, 0.001);
+  animation.advance = [&](double time) {
+    blob.blobs_origin[0] = start[0] + Point3(0, -0.1 * time, 0);
+    blob.blobs_origin[1] = start[1] + Point3(0, 0.1 * time, 0);
+  };
+  animation.render(25, 1.0, "images/blob_animation_");
+}
+
 void create_polygon_in_scene(Scene& scene) {
 
   Caracteristics caracteristics_blue(Pixel(0, 0, 255), 0.8, 0, 1);
@@ -271,6 +296,7 @@ int main() {
   polygon();
   //refraction_sphere_on_plane();
   //blob_test();
+  //blob_animation();
   //triangle_on_plane();
   //simple_plane();
   //two_spheres_on_plane();
@@ -4,4 +4,5 @@
 #include "Vector3.hh"
 #include "Blob.hh"
 #include "TriangleMesh.hh"
+#include "Animation.hh"
 
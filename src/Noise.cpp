@@ -0,0 +1,384 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include "Noise.hh"
+
+GradientNoise::GradientNoise(std::uint32_t seed) {
+  std::iota(permutation.begin(), permutation.begin() + 256, 0);
+  std::mt19937 generator(seed);
+  std::shuffle(permutation.begin(), permutation.begin() + 256, generator);
+  std::copy(permutation.begin(), permutation.begin() + 256, permutation.begin() + 256);
+}
+
+//Gradients picked by the low bits of the hashes
+//2D Perlin: (±1, ±2) and (±2, ±1)
+static constexpr double perlin2_x[8] = {2, 2, -2, -2, 1, -1, 1, -1};
+static constexpr double perlin2_y[8] = {1, -1, 1, -1, 2, 2, -2, -2};
+//2D simplex: the axes and the diagonals
+static constexpr double simplex2_x[8] = {1, -1, 1, -1, 1, -1, 0, 0};
+static constexpr double simplex2_y[8] = {1, 1, -1, -1, 0, 0, 1, -1};
+//3D: the 12 edges of a cube, four of them twice so that the hash only has to be masked
+static constexpr double gradient3_x[16] = {1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0, 1, 0, -1, 0};
+static constexpr double gradient3_y[16] = {1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1};
+static constexpr double gradient3_z[16] = {0, 0, 0, 0, 1, 1, -1, -1, 1, 1, -1, -1, 0, 1, 0, -1};
+
+template <typename Real> constexpr int lane_count = 1;
+template <> constexpr int lane_count<Double4> = 4;
+
+static void store_lanes(double value, double* lanes) {
+  lanes[0] = value;
+}
+
+static void store_lanes(Double4 value, double* lanes) {
+  value.store(lanes);
+}
+
+template <typename Real> static Real gather(const double* table, const int* indices);
+
+template <> double gather<double>(const double* table, const int* indices) {
+  return table[indices[0]];
+}
+
+template <> Double4 gather<Double4>(const double* table, const int* indices) {
+  return Double4(table[indices[0]], table[indices[1]], table[indices[2]], table[indices[3]]);
+}
+
+static double select(bool mask, double a, double b) {
+  return mask ? a : b;
+}
+
+static double positive_part(double value) {
+  return value > 0 ? value : 0;
+}
+
+static Double4 positive_part(Double4 value) {
+  return max(value, Double4(0.0));
+}
+
+//6t^5 - 15t^4 + 10t^3, its first and second derivatives are null at 0 and 1
+template <typename Real>
+static Real fade(Real t) {
+  return t * t * t * (t * (t * Real(6.0) - Real(15.0)) + Real(10.0));
+}
+
+template <typename Real>
+static Real lerp(Real t, Real a, Real b) {
+  return a + t * (b - a);
+}
+
+//Falloff of a simplex corner, t^4 inside the radius and 0 outside
+template <typename Real>
+static Real falloff(Real radius_square, Real distance_square) {
+  Real t = positive_part(radius_square - distance_square);
+  t = t * t;
+  return t * t;
+}
+
+template <typename Real>
+Real GradientNoise::perlin_kernel(Real x, Real y) const {
+  using std::floor;
+  constexpr int lanes = lane_count<Real>;
+  Real floor_x = floor(x);
+  Real floor_y = floor(y);
+  double cells_x[lanes], cells_y[lanes];
+  store_lanes(floor_x, cells_x);
+  store_lanes(floor_y, cells_y);
+  int hashes[4][lanes];
+  for (int lane = 0; lane < lanes; ++lane) {
+    int cell_x = static_cast<int>(cells_x[lane]) & 255;
+    int cell_y = static_cast<int>(cells_y[lane]) & 255;
+    int a = permutation[cell_x] + cell_y;
+    int b = permutation[cell_x + 1] + cell_y;
+    hashes[0][lane] = permutation[a] & 7;
+    hashes[1][lane] = permutation[b] & 7;
+    hashes[2][lane] = permutation[a + 1] & 7;
+    hashes[3][lane] = permutation[b + 1] & 7;
+  }
+  x = x - floor_x;
+  y = y - floor_y;
+  Real x1 = x - Real(1.0);
+  Real y1 = y - Real(1.0);
+  auto corner = [&](int index, Real dx, Real dy) {
+    return gather<Real>(perlin2_x, hashes[index]) * dx + gather<Real>(perlin2_y, hashes[index]) * dy;
+  };
+  Real u = fade(x);
+  Real v = fade(y);
+  //The gradients have a norm of sqrt(5), this brings the values back to about [-1, 1]
+  return Real(0.5) * lerp(v, lerp(u, corner(0, x, y), corner(1, x1, y)), lerp(u, corner(2, x, y1), corner(3, x1, y1)));
+}
+
+template <typename Real>
+Real GradientNoise::perlin_kernel(Real x, Real y, Real z) const {
+  using std::floor;
+  constexpr int lanes = lane_count<Real>;
+  Real floor_x = floor(x);
+  Real floor_y = floor(y);
+  Real floor_z = floor(z);
+  double cells_x[lanes], cells_y[lanes], cells_z[lanes];
+  store_lanes(floor_x, cells_x);
+  store_lanes(floor_y, cells_y);
+  store_lanes(floor_z, cells_z);
+  //Corner i is at (i & 1, (i >> 1) & 1, i >> 2) in the cell
+  int hashes[8][lanes];
+  for (int lane = 0; lane < lanes; ++lane) {
+    int cell_x = static_cast<int>(cells_x[lane]) & 255;
+    int cell_y = static_cast<int>(cells_y[lane]) & 255;
+    int cell_z = static_cast<int>(cells_z[lane]) & 255;
+    int a = permutation[cell_x] + cell_y;
+    int b = permutation[cell_x + 1] + cell_y;
+    int aa = permutation[a] + cell_z;
+    int ab = permutation[a + 1] + cell_z;
+    int ba = permutation[b] + cell_z;
+    int bb = permutation[b + 1] + cell_z;
+    hashes[0][lane] = permutation[aa] & 15;
+    hashes[1][lane] = permutation[ba] & 15;
+    hashes[2][lane] = permutation[ab] & 15;
+    hashes[3][lane] = permutation[bb] & 15;
+    hashes[4][lane] = permutation[aa + 1] & 15;
+    hashes[5][lane] = permutation[ba + 1] & 15;
+    hashes[6][lane] = permutation[ab + 1] & 15;
+    hashes[7][lane] = permutation[bb + 1] & 15;
+  }
+  x = x - floor_x;
+  y = y - floor_y;
+  z = z - floor_z;
+  Real x1 = x - Real(1.0);
+  Real y1 = y - Real(1.0);
+  Real z1 = z - Real(1.0);
+  auto corner = [&](int index, Real dx, Real dy, Real dz) {
+    return gather<Real>(gradient3_x, hashes[index]) * dx + gather<Real>(gradient3_y, hashes[index]) * dy
+           + gather<Real>(gradient3_z, hashes[index]) * dz;
+  };
+  Real u = fade(x);
+  Real v = fade(y);
+  Real w = fade(z);
+  return lerp(w, lerp(v, lerp(u, corner(0, x, y, z), corner(1, x1, y, z)),
+                      lerp(u, corner(2, x, y1, z), corner(3, x1, y1, z))),
+              lerp(v, lerp(u, corner(4, x, y, z1), corner(5, x1, y, z1)),
+                   lerp(u, corner(6, x, y1, z1), corner(7, x1, y1, z1))));
+}
+
+template <typename Real>
+Real GradientNoise::simplex_kernel(Real x, Real y) const {
+  using std::floor;
+  constexpr int lanes = lane_count<Real>;
+  //Skewing to the lattice of squares made of two triangles and back
+  const double skew = 0.5 * (std::sqrt(3.0) - 1.0);
+  const double unskew = (3.0 - std::sqrt(3.0)) / 6.0;
+  Real s = (x + y) * Real(skew);
+  Real i = floor(x + s);
+  Real j = floor(y + s);
+  Real t = (i + j) * Real(unskew);
+  Real x0 = x - (i - t);
+  Real y0 = y - (j - t);
+  //The middle corner of the triangle holding the point
+  auto lower = x0 > y0;
+  Real i1 = select(lower, Real(1.0), Real(0.0));
+  Real j1 = select(lower, Real(0.0), Real(1.0));
+  Real x1 = x0 - i1 + Real(unskew);
+  Real y1 = y0 - j1 + Real(unskew);
+  Real x2 = x0 - Real(1.0 - 2.0 * unskew);
+  Real y2 = y0 - Real(1.0 - 2.0 * unskew);
+
+  double cells_i[lanes], cells_j[lanes], offsets_i[lanes];
+  store_lanes(i, cells_i);
+  store_lanes(j, cells_j);
+  store_lanes(i1, offsets_i);
+  int hashes[3][lanes];
+  for (int lane = 0; lane < lanes; ++lane) {
+    int cell_i = static_cast<int>(cells_i[lane]) & 255;
+    int cell_j = static_cast<int>(cells_j[lane]) & 255;
+    int offset_i = static_cast<int>(offsets_i[lane]);
+    hashes[0][lane] = permutation[cell_i + permutation[cell_j]] & 7;
+    hashes[1][lane] = permutation[cell_i + offset_i + permutation[cell_j + 1 - offset_i]] & 7;
+    hashes[2][lane] = permutation[cell_i + 1 + permutation[cell_j + 1]] & 7;
+  }
+  auto corner = [&](int index, Real dx, Real dy) {
+    return falloff(Real(0.5), dx * dx + dy * dy)
+           * (gather<Real>(simplex2_x, hashes[index]) * dx + gather<Real>(simplex2_y, hashes[index]) * dy);
+  };
+  return Real(70.0) * (corner(0, x0, y0) + corner(1, x1, y1) + corner(2, x2, y2));
+}
+
+template <typename Real>
+Real GradientNoise::simplex_kernel(Real x, Real y, Real z) const {
+  using std::floor;
+  using std::max;
+  using std::min;
+  constexpr int lanes = lane_count<Real>;
+  const double skew = 1.0 / 3.0;
+  const double unskew = 1.0 / 6.0;
+  Real s = (x + y + z) * Real(skew);
+  Real i = floor(x + s);
+  Real j = floor(y + s);
+  Real k = floor(z + s);
+  Real t = (i + j + k) * Real(unskew);
+  Real x0 = x - (i - t);
+  Real y0 = y - (j - t);
+  Real z0 = z - (k - t);
+  //Ranking the coordinates gives the two middle corners of the tetrahedron holding the point
+  Real one(1.0);
+  Real zero(0.0);
+  Real x_ge_y = select(x0 >= y0, one, zero);
+  Real y_ge_z = select(y0 >= z0, one, zero);
+  Real z_ge_x = select(z0 >= x0, one, zero);
+  Real i1 = min(x_ge_y, one - z_ge_x);
+  Real j1 = min(y_ge_z, one - x_ge_y);
+  Real k1 = min(z_ge_x, one - y_ge_z);
+  Real i2 = max(x_ge_y, one - z_ge_x);
+  Real j2 = max(y_ge_z, one - x_ge_y);
+  Real k2 = max(z_ge_x, one - y_ge_z);
+  Real x1 = x0 - i1 + Real(unskew);
+  Real y1 = y0 - j1 + Real(unskew);
+  Real z1 = z0 - k1 + Real(unskew);
+  Real x2 = x0 - i2 + Real(2.0 * unskew);
+  Real y2 = y0 - j2 + Real(2.0 * unskew);
+  Real z2 = z0 - k2 + Real(2.0 * unskew);
+  Real x3 = x0 - Real(1.0 - 3.0 * unskew);
+  Real y3 = y0 - Real(1.0 - 3.0 * unskew);
+  Real z3 = z0 - Real(1.0 - 3.0 * unskew);
+
+  double cells[3][lanes], first[3][lanes], second[3][lanes];
+  store_lanes(i, cells[0]);
+  store_lanes(j, cells[1]);
+  store_lanes(k, cells[2]);
+  store_lanes(i1, first[0]);
+  store_lanes(j1, first[1]);
+  store_lanes(k1, first[2]);
+  store_lanes(i2, second[0]);
+  store_lanes(j2, second[1]);
+  store_lanes(k2, second[2]);
+  int hashes[4][lanes];
+  for (int lane = 0; lane < lanes; ++lane) {
+    int cell_i = static_cast<int>(cells[0][lane]) & 255;
+    int cell_j = static_cast<int>(cells[1][lane]) & 255;
+    int cell_k = static_cast<int>(cells[2][lane]) & 255;
+    auto hash = [&](int di, int dj, int dk) {
+      return permutation[cell_i + di + permutation[cell_j + dj + permutation[cell_k + dk]]] & 15;
+    };
+    hashes[0][lane] = hash(0, 0, 0);
+    hashes[1][lane] = hash(static_cast<int>(first[0][lane]), static_cast<int>(first[1][lane]),
+                           static_cast<int>(first[2][lane]));
+    hashes[2][lane] = hash(static_cast<int>(second[0][lane]), static_cast<int>(second[1][lane]),
+                           static_cast<int>(second[2][lane]));
+    hashes[3][lane] = hash(1, 1, 1);
+  }
+  auto corner = [&](int index, Real dx, Real dy, Real dz) {
+    return falloff(Real(0.6), dx * dx + dy * dy + dz * dz)
+           * (gather<Real>(gradient3_x, hashes[index]) * dx + gather<Real>(gradient3_y, hashes[index]) * dy
+              + gather<Real>(gradient3_z, hashes[index]) * dz);
+  };
+  return Real(32.0) * (corner(0, x0, y0, z0) + corner(1, x1, y1, z1) + corner(2, x2, y2, z2)
+                       + corner(3, x3, y3, z3));
+}
+
+template <typename Real>
+Real GradientNoise::fbm_kernel(NoiseBasis basis, Real x, Real y, const Fractal& fractal) const {
+  Real value(0.0);
+  double amplitude = 1;
+  for (int octave = 0; octave < fractal.octaves; ++octave) {
+    Real noise = basis == NoiseBasis::perlin ? perlin_kernel(x, y) : simplex_kernel(x, y);
+    value = value + Real(amplitude) * noise;
+    x = x * Real(fractal.lacunarity);
+    y = y * Real(fractal.lacunarity);
+    amplitude *= fractal.gain;
+  }
+  return value;
+}
+
+template <typename Real>
+Real GradientNoise::fbm_kernel(NoiseBasis basis, Real x, Real y, Real z, const Fractal& fractal) const {
+  Real value(0.0);
+  double amplitude = 1;
+  for (int octave = 0; octave < fractal.octaves; ++octave) {
+    Real noise = basis == NoiseBasis::perlin ? perlin_kernel(x, y, z) : simplex_kernel(x, y, z);
+    value = value + Real(amplitude) * noise;
+    x = x * Real(fractal.lacunarity);
+    y = y * Real(fractal.lacunarity);
+    z = z * Real(fractal.lacunarity);
+    amplitude *= fractal.gain;
+  }
+  return value;
+}
+
+double GradientNoise::perlin(double x, double y) const {
+  return perlin_kernel(x, y);
+}
+
+double GradientNoise::perlin(double x, double y, double z) const {
+  return perlin_kernel(x, y, z);
+}
+
+double GradientNoise::simplex(double x, double y) const {
+  return simplex_kernel(x, y);
+}
+
+double GradientNoise::simplex(double x, double y, double z) const {
+  return simplex_kernel(x, y, z);
+}
+
+Double4 GradientNoise::perlin(Double4 x, Double4 y) const {
+  return perlin_kernel(x, y);
+}
+
+Double4 GradientNoise::perlin(Double4 x, Double4 y, Double4 z) const {
+  return perlin_kernel(x, y, z);
+}
+
+Double4 GradientNoise::simplex(Double4 x, Double4 y) const {
+  return simplex_kernel(x, y);
+}
+
+Double4 GradientNoise::simplex(Double4 x, Double4 y, Double4 z) const {
+  return simplex_kernel(x, y, z);
+}
+
+double GradientNoise::fbm(NoiseBasis basis, double x, double y, const Fractal& fractal) const {
+  return fbm_kernel(basis, x, y, fractal);
+}
+
+double GradientNoise::fbm(NoiseBasis basis, double x, double y, double z, const Fractal& fractal) const {
+  return fbm_kernel(basis, x, y, z, fractal);
+}
+
+Double4 GradientNoise::fbm(NoiseBasis basis, Double4 x, Double4 y, const Fractal& fractal) const {
+  return fbm_kernel(basis, x, y, fractal);
+}
+
+Double4 GradientNoise::fbm(NoiseBasis basis, Double4 x, Double4 y, Double4 z, const Fractal& fractal) const {
+  return fbm_kernel(basis, x, y, z, fractal);
+}
+
+void GradientNoise::fbm(NoiseBasis basis, const double* x, const double* y, double* values, std::size_t count,
+                        const Fractal& fractal) const {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    fbm_kernel(basis, Double4::load(x + i), Double4::load(y + i), fractal).store(values + i);
+  }
+  //The last points are padded to a full packet
+  if (i < count) {
+    double last_x[4] = {}, last_y[4] = {}, last_values[4];
+    std::copy(x + i, x + count, last_x);
+    std::copy(y + i, y + count, last_y);
+    fbm_kernel(basis, Double4::load(last_x), Double4::load(last_y), fractal).store(last_values);
+    std::copy(last_values, last_values + (count - i), values + i);
+  }
+}
+
+void GradientNoise::fbm(NoiseBasis basis, const double* x, const double* y, const double* z, double* values,
+                        std::size_t count, const Fractal& fractal) const {
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    fbm_kernel(basis, Double4::load(x + i), Double4::load(y + i), Double4::load(z + i), fractal).store(values + i);
+  }
+  if (i < count) {
+    double last_x[4] = {}, last_y[4] = {}, last_z[4] = {}, last_values[4];
+    std::copy(x + i, x + count, last_x);
+    std::copy(y + i, y + count, last_y);
+    std::copy(z + i, z + count, last_z);
+    fbm_kernel(basis, Double4::load(last_x), Double4::load(last_y), Double4::load(last_z), fractal).store(last_values);
+    std::copy(last_values, last_values + (count - i), values + i);
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "Simd.hh"
+
+enum class NoiseBasis { perlin, simplex };
+
+//Octaves of a fractal sum, each one lacunarity times finer and gain times weaker than the previous one
+struct Fractal
+{
+  int octaves = 4;
+  double lacunarity = 2.0;
+  double gain = 0.5;
+};
+
+//Perlin and simplex gradient noise in 2D and 3D, values in about [-1, 1], 0 on the integer lattice
+//The Double4 overloads evaluate four points at once, one per lane, and match the scalar ones up to rounding
+class GradientNoise
+{
+public:
+  explicit GradientNoise(std::uint32_t seed = 0);
+
+  [[nodiscard]] double perlin(double x, double y) const;
+  [[nodiscard]] double perlin(double x, double y, double z) const;
+  [[nodiscard]] double simplex(double x, double y) const;
+  [[nodiscard]] double simplex(double x, double y, double z) const;
+
+  [[nodiscard]] Double4 perlin(Double4 x, Double4 y) const;
+  [[nodiscard]] Double4 perlin(Double4 x, Double4 y, Double4 z) const;
+  [[nodiscard]] Double4 simplex(Double4 x, Double4 y) const;
+  [[nodiscard]] Double4 simplex(Double4 x, Double4 y, Double4 z) const;
+
+  [[nodiscard]] double fbm(NoiseBasis basis, double x, double y, const Fractal& fractal) const;
+  [[nodiscard]] double fbm(NoiseBasis basis, double x, double y, double z, const Fractal& fractal) const;
+  [[nodiscard]] Double4 fbm(NoiseBasis basis, Double4 x, Double4 y, const Fractal& fractal) const;
+  [[nodiscard]] Double4 fbm(NoiseBasis basis, Double4 x, Double4 y, Double4 z, const Fractal& fractal) const;
+
+  //Batch evaluation, values[i] is the fbm at (x[i], y[i]), computed four points at a time
+  void fbm(NoiseBasis basis, const double* x, const double* y, double* values, std::size_t count,
+           const Fractal& fractal) const;
+  void fbm(NoiseBasis basis, const double* x, const double* y, const double* z, double* values, std::size_t count,
+           const Fractal& fractal) const;
+
+private:
+  //Written once for double and Double4, only the hashing of the lattice points is done lane by lane
+  template <typename Real> Real perlin_kernel(Real x, Real y) const;
+  template <typename Real> Real perlin_kernel(Real x, Real y, Real z) const;
+  template <typename Real> Real simplex_kernel(Real x, Real y) const;
+  template <typename Real> Real simplex_kernel(Real x, Real y, Real z) const;
+  template <typename Real> Real fbm_kernel(NoiseBasis basis, Real x, Real y, const Fractal& fractal) const;
+  template <typename Real> Real fbm_kernel(NoiseBasis basis, Real x, Real y, Real z, const Fractal& fractal) const;
+
+  std::array<std::uint8_t, 512> permutation; //Twice the same shuffle of 0..255 so that p[p[x] + y] needs no wrap
+};
@@ -1,5 +1,6 @@
 #include "Object.hh"
 #include <cmath>
+#include <limits>
 #include <utility>
 
 Object::Object(std::shared_ptr<Texture_Material> texture_material)
@@ -35,6 +36,8 @@ SmoothTriangle::SmoothTriangle(std::shared_ptr<Texture_Material> texture_materia
     , A(A)
     , B(B)
     , C(C)
+    , AB(Vector3(A, B))
+    , AC(Vector3(A, C))
     , normA(normA)
     , normB(normB)
     , normC(normC)
@@ -42,86 +45,233 @@ SmoothTriangle::SmoothTriangle(std::shared_ptr<Texture_Material> texture_materia
     , B_text_coord(std::move(B_text_coord))
     , C_text_coord(std::move(C_text_coord))
 {}
+std::optional<HitRecord> Object::find_nearest(const Rayon& ray, double t_min, double t_max) const {
+  std::optional<HitRecord> hit = is_intersecting(ray);
+  if (hit && hit->t > t_min && hit->t < t_max) {
+    return hit;
+  }
+  return std::optional<HitRecord>();
+}
+
+void Object::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const {
+  for (int lane = 0; lane < packet.count; ++lane) {
+    std::optional<HitRecord> hit = find_nearest(packet.ray(lane), t_min, closest.t[lane]);
+    if (hit) {
+      closest.record(lane, hit.value(), this);
+    }
+  }
+}
+
+bool Object::is_occluding(const Rayon& ray, double t_min, double t_max) const {
+  std::optional<HitRecord> hit = is_intersecting(ray);
+  return hit && hit->t > t_min && hit->t < t_max;
+}
+
 //-----------------------------------------------SPHERE------------------------------------------------------------//
 
-std::optional<double> Sphere::is_intersecting(const Rayon& ray)
+std::optional<HitRecord> Sphere::is_intersecting(const Rayon& ray) const
 {
     // Formulas from wikipedia, verified on paper
-    double a = std::pow(ray.direction.norm(), 2.0);
+    double a = ray.direction.scalar_product(ray.direction);
     Vector3 sphere_to_point(this->origin, ray.origin);
     double b = 2.0 * (ray.direction.scalar_product(sphere_to_point));
-    double c = std::pow(sphere_to_point.norm(), 2.0) - std::pow(this->radius, 2.0);
-    double delta = std::pow(b, 2.0) - 4.0 * a * c;
+    double c = sphere_to_point.scalar_product(sphere_to_point) - this->radius * this->radius;
+    double delta = b * b - 4.0 * a * c;
     if (delta < 0.0) {
-        return std::optional<double>();
+        return std::optional<HitRecord>();
     } else if (delta == 0.0) {
-        return std::optional<double>(-b / (2.0 * a));
+        return HitRecord{-b / (2.0 * a)};
     }
     double t0 = (-b - std::sqrt(delta)) / (2.0 * a);
     double t1 = (-b + std::sqrt(delta)) / (2.0 * a);
     if (t0 < 0 && t1 < 0) {
-      return std::optional<double>();
+      return std::optional<HitRecord>();
     } else if (t0 < 0) {
-      return t1;
+      return HitRecord{t1};
     } else if (t1 < 0) {
-      return t0;
+      return HitRecord{t0};
+    }
+    return HitRecord{std::min(t0, t1)};
+}
+
+//Same filter as Object::find_nearest, the qualified call does not go through the vtable
+std::optional<HitRecord> Sphere::find_nearest(const Rayon& ray, double t_min, double t_max) const
+{
+    std::optional<HitRecord> hit = Sphere::is_intersecting(ray);
+    if (hit && hit->t > t_min && hit->t < t_max) {
+        return hit;
+    }
+    return std::optional<HitRecord>();
+}
+
+//Unlike is_intersecting both roots are candidates, the ray may start on the sphere and go through it
+bool Sphere::is_occluding(const Rayon& ray, double t_min, double t_max) const
+{
+    double a = ray.direction.scalar_product(ray.direction);
+    Vector3 sphere_to_point(this->origin, ray.origin);
+    double b = 2.0 * (ray.direction.scalar_product(sphere_to_point));
+    double c = sphere_to_point.scalar_product(sphere_to_point) - this->radius * this->radius;
+    double delta = b * b - 4.0 * a * c;
+    if (delta < 0.0) {
+        return false;
     }
-    return std::min(t0, t1);
+    double t0 = (-b - std::sqrt(delta)) / (2.0 * a);
+    double t1 = (-b + std::sqrt(delta)) / (2.0 * a);
+    return (t0 > t_min && t0 < t_max) || (t1 > t_min && t1 < t_max);
 }
 
-Vector3 Sphere::normal_at_point(const Point3& point, const Rayon&)
+//Same computation as is_intersecting on the four lanes
+void Sphere::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const
+{
+    Vector3x4 sphere_to_point = packet.origin - Vector3x4{Double4(origin.x), Double4(origin.y), Double4(origin.z)};
+    Double4 a = dot(packet.direction, packet.direction);
+    Double4 b = Double4(2.0) * dot(packet.direction, sphere_to_point);
+    Double4 c = dot(sphere_to_point, sphere_to_point) - Double4(this->radius * this->radius);
+    Double4 delta = b * b - Double4(4.0) * a * c;
+    Double4 root = sqrt(max(delta, Double4(0.0)));
+    Double4 t0 = (-b - root) / (Double4(2.0) * a);
+    Double4 t1 = (-b + root) / (Double4(2.0) * a);
+    Double4 t = select(t0 < Double4(0.0), t1, t0);
+    Mask4 valid = (delta >= Double4(0.0)) & (t > Double4(t_min)) & (t < closest.t);
+    closest.record(valid, t, Double4(), Double4(), this);
+}
+
+Vector3 Sphere::normal_at_point(const HitRecord&, const Point3& point, const Rayon&) const
 {
     return Vector3(point.x - origin.x, point.y - origin.y, point.z - origin.z);
 }
 
-Caracteristics Sphere::texture_at_point(const Point3&) {
-    return texture_material->caracteristics;
+Caracteristics Sphere::texture_at_point(const HitRecord&, const Point3& point) const {
+    return texture_material->caracteristics_solid(point);
+}
+
+std::optional<BoundingBox> Sphere::bounding_box() const {
+    Vector3 half_size(radius, radius, radius);
+    return BoundingBox(origin - half_size, origin + half_size).pad(epsilon);
 }
 
 //-----------------------------------------------PLANE--------------------------------------------------------------//
 
-std::optional<double> Plane::is_intersecting(const Rayon& ray) {
+std::optional<HitRecord> Plane::is_intersecting(const Rayon& ray) const {
     auto scalar = ray.direction.scalar_product(normal);
     if (scalar == 0.0) {
-        return std::optional<double>(); //The line could be inside the plane but I don't take into account this case
+        return std::optional<HitRecord>(); //The line could be inside the plane but I don't take into account this case
     }
     auto tmp = Vector3(ray.origin, this->point).scalar_product(this->normal);
-    return tmp / scalar;
+    return HitRecord{tmp / scalar};
+}
+
+std::optional<HitRecord> Plane::find_nearest(const Rayon& ray, double t_min, double t_max) const {
+    std::optional<HitRecord> hit = Plane::is_intersecting(ray);
+    if (hit && hit->t > t_min && hit->t < t_max) {
+        return hit;
+    }
+    return std::optional<HitRecord>();
+}
+
+void Plane::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const {
+    Vector3x4 normal4 = {Double4(normal.x), Double4(normal.y), Double4(normal.z)};
+    Vector3x4 point4 = {Double4(point.x), Double4(point.y), Double4(point.z)};
+    Double4 scalar = dot(packet.direction, normal4);
+    Double4 t = dot(point4 - packet.origin, normal4) / scalar;
+    Mask4 valid = (scalar != Double4(0.0)) & (t > Double4(t_min)) & (t < closest.t);
+    closest.record(valid, t, Double4(), Double4(), this);
 }
 
-Vector3 Plane::normal_at_point(const Point3&, const Rayon& ray) {
+Vector3 Plane::normal_at_point(const HitRecord&, const Point3&, const Rayon& ray) const {
   if (ray.direction.scalar_product(this->normal) > 0) {
     return -1.0 * this->normal;
   }
   return this->normal;
 }
 
-Caracteristics Plane::texture_at_point(const Point3&) {
-    return texture_material->caracteristics;
+Caracteristics Plane::texture_at_point(const HitRecord&, const Point3& point) const {
+    return texture_material->caracteristics_solid(point);
+}
+
+std::optional<BoundingBox> Plane::bounding_box() const {
+    return std::optional<BoundingBox>();
 }
 
 //-----------------------------------------------TRIANGLE--------------------------------------------------------------//
-std::optional<double> Triangle::is_intersecting(const Rayon &ray) {
+double texture_scale(const Vector3& AB, const Vector3& AC, const Point3& A_text_coord, const Point3& B_text_coord,
+                     const Point3& C_text_coord) {
+  double area = AB.vector_product(AC).norm();
+  double text_area = std::fabs((B_text_coord.x - A_text_coord.x) * (C_text_coord.y - A_text_coord.y)
+                               - (B_text_coord.y - A_text_coord.y) * (C_text_coord.x - A_text_coord.x));
+  return area > 0 ? std::sqrt(text_area / area) : 0.0;
+}
+
+//Moller Trumbore
+// P = (D * AC)   Q = (OA * AB)
+// determinant = (D * AC) . AB or P . AB
+// u = ((D * AC) . AO) / determinant or (P. AO) / determinant
+// v = ((AO * AB) . D) / determinant or (Q . D) / determinant
+// t = ((AO * AB) . AC) / determinant or (Q. AC) / determinant
+std::optional<HitRecord> intersect_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const Rayon& ray,
+                                            double t_min, double t_max, double epsilon) {
   Vector3 D = ray.direction;
   Vector3 P = D.vector_product(AC);
   double determinant = P.scalar_product(AB);
   if (std::fabs(determinant) < epsilon) // ray too much parallel to triangle
-    return std::optional<double>();
+    return std::optional<HitRecord>();
 
   double invDeterminant = 1.0 / determinant;
   Vector3 AO(A, ray.origin);
   double u = invDeterminant * AO.scalar_product(P);
   if (u < 0 || u > 1) // outside of triangle
-    return std::optional<double>();
+    return std::optional<HitRecord>();
 
   Vector3 Q = AO.vector_product(AB);
   double v = invDeterminant * D.scalar_product(Q);
-  //double w = 1.0 - u - v;
   if (v < 0 || u + v > 1) // outside of triangle
-    return std::optional<double>();
+    return std::optional<HitRecord>();
 
   double t = invDeterminant * AC.scalar_product(Q);
-  return t;
+  if (t <= t_min || t >= t_max)
+    return std::optional<HitRecord>();
+  return HitRecord{t, u, v};
+}
+
+bool occlude_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const Rayon& ray, double t_min,
+                      double t_max, double epsilon) {
+  Vector3 P = ray.direction.vector_product(AC);
+  double determinant = P.scalar_product(AB);
+  if (std::fabs(determinant) < epsilon)
+    return false;
+
+  double invDeterminant = 1.0 / determinant;
+  Vector3 AO(A, ray.origin);
+  Vector3 Q = AO.vector_product(AB);
+  //The distance is checked first, most triangles of a big mesh are out of the range of a shadow ray
+  double t = invDeterminant * AC.scalar_product(Q);
+  if (t <= t_min || t >= t_max)
+    return false;
+
+  double u = invDeterminant * AO.scalar_product(P);
+  if (u < 0 || u > 1)
+    return false;
+  double v = invDeterminant * ray.direction.scalar_product(Q);
+  return v >= 0 && u + v <= 1;
+}
+
+std::optional<HitRecord> Triangle::is_intersecting(const Rayon &ray) const {
+  return intersect_triangle(A, AB, AC, ray, -std::numeric_limits<double>::infinity()
+                            , std::numeric_limits<double>::infinity(), epsilon);
+}
+
+std::optional<HitRecord> Triangle::find_nearest(const Rayon &ray, double t_min, double t_max) const {
+  return intersect_triangle(A, AB, AC, ray, t_min, t_max, epsilon);
+}
+
+bool Triangle::is_occluding(const Rayon &ray, double t_min, double t_max) const {
+  return occlude_triangle(A, AB, AC, ray, t_min, t_max, epsilon);
+}
+
+void Triangle::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const {
+  Double4 t, u, v;
+  Mask4 valid = intersect_triangle(A, AB, AC, packet, t_min, closest.t, epsilon, t, u, v);
+  closest.record(valid, t, u, v, this);
 }
 /*
 //ScratchPixel formulas for edges
@@ -149,15 +299,20 @@ std::optional<double> Triangle::is_intersecting(const Rayon& ray) {
 }
  */
 
-Vector3 Triangle::normal_at_point(const Point3&, const Rayon& ray) {
+Vector3 Triangle::normal_at_point(const HitRecord&, const Point3&, const Rayon& ray) const {
   if (ray.direction.scalar_product(this->normal) > 0) {
     return -1.0 * this->normal;
   }
   return this->normal;
 }
 
-Caracteristics Triangle::texture_at_point(const Point3&) {
-  return texture_material->caracteristics;
+Caracteristics Triangle::texture_at_point(const HitRecord&, const Point3& point) const {
+  return texture_material->caracteristics_solid(point);
+}
+
+//Padded so that axis aligned triangles do not give a flat box
+std::optional<BoundingBox> Triangle::bounding_box() const {
+  return BoundingBox().expand(A).expand(B).expand(C).pad(epsilon);
 }
 
 std::ostream& operator<<(std::ostream& ost, const Triangle& triangle) {
@@ -168,52 +323,48 @@ std::ostream& operator<<(std::ostream& ost, const Triangle& triangle) {
 
 //-----------------------------------------------SMOOTHTRIANGLE-------------------------------------------------------//
 
-//Moller Trumbore
-// P = (D * AC)   Q = (OA * AB)
-// determinant = (D * AC) . AB or P . AB
-// u = ((D * AC) . AO) / determinant or (P. AO) / determinant
-// v = ((AO * AB) . D) / determinant or (Q . D) / determinant
-// t = ((AO * AB) . AC) / determinant or (Q. AC) / determinant
-std::optional<double> SmoothTriangle::is_intersecting(const Rayon &ray) {
-  Vector3 D = ray.direction;
-  Vector3 AC = Vector3(A, C);
-  Vector3 AB = Vector3(A, B);
-  Vector3 P = D.vector_product(AC);
-  double determinant = P.scalar_product(AB);
-  if (std::fabs(determinant) < epsilon) // ray too much parallel to triangle
-    return std::optional<double>();
+std::optional<HitRecord> SmoothTriangle::is_intersecting(const Rayon &ray) const {
+  return intersect_triangle(A, AB, AC, ray, -std::numeric_limits<double>::infinity()
+                            , std::numeric_limits<double>::infinity(), epsilon);
+}
 
-  double invDeterminant = 1.0 / determinant;
-  Vector3 AO(A, ray.origin);
-  u = invDeterminant * AO.scalar_product(P);
-  if (u < 0 || u > 1) // outside of triangle
-    return std::optional<double>();
+std::optional<HitRecord> SmoothTriangle::find_nearest(const Rayon &ray, double t_min, double t_max) const {
+  return intersect_triangle(A, AB, AC, ray, t_min, t_max, epsilon);
+}
 
-  Vector3 Q = AO.vector_product(AB);
-  v = invDeterminant * D.scalar_product(Q);
-  w = 1.0 - u - v;
-  if (v < 0 || u + v > 1) // outside of triangle
-    return std::optional<double>();
+bool SmoothTriangle::is_occluding(const Rayon &ray, double t_min, double t_max) const {
+  return occlude_triangle(A, AB, AC, ray, t_min, t_max, epsilon);
+}
 
-  double t = invDeterminant * AC.scalar_product(Q);
-  return t;
+void SmoothTriangle::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const {
+  Double4 t, u, v;
+  Mask4 valid = intersect_triangle(A, AB, AC, packet, t_min, closest.t, epsilon, t, u, v);
+  closest.record(valid, t, u, v, this);
 }
 
-//This function should be called only after is_intersecting has been called in order for u,v and w to be initialized
-Vector3 SmoothTriangle::normal_at_point(const Point3&, const Rayon& ray) {
-  Vector3 interpolatedVector = u * normA + v * normB + w * normC;
+//u weights B, v weights C and w = 1 - u - v weights A, like for the texture coordinates
+Vector3 SmoothTriangle::normal_at_point(const HitRecord& hit, const Point3&, const Rayon& ray) const {
+  double w = 1.0 - hit.u - hit.v;
+  Vector3 interpolatedVector = w * normA + hit.u * normB + hit.v * normC;
   if (ray.direction.scalar_product(interpolatedVector) > 0) {
     return -1.0 * interpolatedVector;
   }
   return interpolatedVector;
 }
 
-Caracteristics SmoothTriangle::texture_at_point(const Point3& point) {
+Caracteristics SmoothTriangle::texture_at_point(const HitRecord& hit, const Point3& point) const {
   if (A_text_coord) {//We have texture coordinates and we compute the interpolated texture coordinate
-    Point3 coordinate = A_text_coord.value() * w + B_text_coord.value() * u + C_text_coord.value() * v;
-    return texture_material->caracteristics_point(coordinate);
+    double w = 1.0 - hit.u - hit.v;
+    Point3 coordinate = A_text_coord.value() * w + B_text_coord.value() * hit.u + C_text_coord.value() * hit.v;
+    double footprint = hit.footprint * texture_scale(AB, AC, A_text_coord.value(), B_text_coord.value(),
+                                                     C_text_coord.value());
+    return texture_material->caracteristics_filtered(coordinate, footprint);
   }
-  return texture_material->caracteristics;
+  return texture_material->caracteristics_solid(point);
+}
+
+std::optional<BoundingBox> SmoothTriangle::bounding_box() const {
+  return BoundingBox().expand(A).expand(B).expand(C).pad(epsilon);
 }
 
 std::ostream& operator<<(std::ostream& ost, const SmoothTriangle& triangle) {
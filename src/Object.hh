@@ -3,6 +3,8 @@
 #include <memory>
 #include <optional>
 #include "Rayon.hh"
+#include "RayPacket.hh"
+#include "BoundingBox.hh"
 #include "Vector3.hh"
 #include "Texture_Material.hh"
 
@@ -11,51 +13,88 @@ class Object
 public:
   Object(std::shared_ptr<Texture_Material> texture_material);
 
-    virtual std::optional<double> is_intersecting(const Rayon& ray) = 0;
-    virtual Vector3 normal_at_point(const Point3& point, const Rayon& ray) = 0;
-    virtual Caracteristics texture_at_point(const Point3& point) = 0;
+    virtual std::optional<HitRecord> is_intersecting(const Rayon& ray) const = 0;
+    virtual Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const = 0;
+    virtual Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const = 0;
+
+    //Nearest hit with t_min < t < t_max, the default filters is_intersecting
+    //Objects made of many primitives override it to prune their own hierarchy with the closest hit found so far
+    virtual std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const;
+
+    //Nearest hit of every ray of a packet with t_min < t < closest.t, the closer hits are recorded in closest
+    //The default tests the rays one by one, simple primitives override it with a SIMD version
+    virtual void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const;
+
+    //Any hit query for shadow rays, true if the ray hits the object with t_min < t < t_max
+    //The default goes through is_intersecting, objects can override it to stop as soon as they know the answer
+    virtual bool is_occluding(const Rayon& ray, double t_min, double t_max) const;
+
+    //Empty for unbounded objects like planes, which are kept out of the scene BVH
+    virtual std::optional<BoundingBox> bounding_box() const = 0;
 
   std::shared_ptr<Texture_Material> texture_material;
   double epsilon = 0.000001;
 };
 
-class Sphere : public Object
+class Sphere final : public Object
 {
 public:
     Sphere(std::shared_ptr<Texture_Material> texture_material, Point3 origin, double radius);
 
-    std::optional<double> is_intersecting(const Rayon& ray) override;
+    std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+    std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+    Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
 
-    Vector3 normal_at_point(const Point3& point, const Rayon& ray) override;
+    Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
 
-    Caracteristics texture_at_point(const Point3& point) override;
+    std::optional<BoundingBox> bounding_box() const override;
+
+    void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const override;
+
+    bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
 
     Point3 origin;
     double radius;
 };
 
-class Plane : public Object {
+class Plane final : public Object {
 public:
     Plane(std::shared_ptr<Texture_Material> texture_material, Point3 point, Vector3 normal);
-    std::optional<double> is_intersecting(const Rayon& ray) override;
+    std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+    std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+    Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
+
+    Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
 
-    Vector3 normal_at_point(const Point3& point, const Rayon& ray) override;
+    std::optional<BoundingBox> bounding_box() const override;
 
-    Caracteristics texture_at_point(const Point3& point) override;
+    void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const override;
 
     Point3 point;
     Vector3 normal;
 };
 
-class Triangle : public Object {
+class Triangle final : public Object {
 public:
     Triangle(std::shared_ptr<Texture_Material> texture_material, Point3 A, Point3 B, Point3 C);
 
-    std::optional<double> is_intersecting(const Rayon& ray) override;
+    std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
 
-    Vector3 normal_at_point(const Point3& point, const Rayon& ray) override;
+    std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
 
-    Caracteristics texture_at_point(const Point3& point) override;
+    Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
+
+    Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
+
+    std::optional<BoundingBox> bounding_box() const override;
+
+    void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const override;
+
+    bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
 
     Point3 A;
     Point3 B;
@@ -65,30 +104,49 @@ public:
     Vector3 normal;
 };
 
-class SmoothTriangle : public Object {
+class SmoothTriangle final : public Object {
 public:
     SmoothTriangle(std::shared_ptr<Texture_Material> texture_material, Point3 A, Point3 B, Point3 C, Vector3 normA,
                    Vector3 normB, Vector3 normC, std::optional<Point3> A_text_coord = {}, std::optional<Point3> B_text_coord = {},
                    std::optional<Point3> C_text_coord = {});
 
-  std::optional<double> is_intersecting(const Rayon& ray) override;
+  std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+  std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+  Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
 
-  Vector3 normal_at_point(const Point3& point, const Rayon& ray) override;
+  Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
 
-  Caracteristics texture_at_point(const Point3& point) override;
+  std::optional<BoundingBox> bounding_box() const override;
+
+  void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const override;
+
+  bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
 
   Point3 A;
   Point3 B;
   Point3 C;
+  Vector3 AB;
+  Vector3 AC;
   Vector3 normA;
   Vector3 normB;
   Vector3 normC;
-  double u;
-  double v;
-  double w;
   std::optional<Point3> A_text_coord; //TODO Actually it is a Point2
   std::optional<Point3> B_text_coord;
   std::optional<Point3> C_text_coord;
 };
 
+//Moller Trumbore test shared by every kind of triangle, the hit has t_min < t < t_max
+std::optional<HitRecord> intersect_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const Rayon& ray,
+                                            double t_min, double t_max, double epsilon);
+
+//Same test for shadow rays, the distance is checked before the barycentric coordinates
+bool occlude_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const Rayon& ray, double t_min,
+                      double t_max, double epsilon);
+
+//Texture coordinates per unit of length on a triangle, the square root of the ratio of its areas in texture and in space
+double texture_scale(const Vector3& AB, const Vector3& AC, const Point3& A_text_coord, const Point3& B_text_coord,
+                     const Point3& C_text_coord);
+
 std::ostream& operator<<(std::ostream& ost, const Triangle& triangle);
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "PointGrid.hh"
+
+void PointGrid::build(const std::vector<Point3>& points, double cell_size) {
+  this->cell_size = cell_size;
+  //About two buckets per point keeps the collisions rare
+  std::uint32_t bucket_count = 1;
+  while (bucket_count < 2 * points.size()) {
+    bucket_count *= 2;
+  }
+  bucket_mask = bucket_count - 1;
+
+  //Counting sort of the points by bucket
+  std::vector<std::uint32_t> point_buckets(points.size());
+  bucket_starts.assign(bucket_count + 1, 0);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    point_buckets[i] = bucket(std::floor(points[i].x / cell_size), std::floor(points[i].y / cell_size),
+                              std::floor(points[i].z / cell_size));
+    ++bucket_starts[point_buckets[i] + 1];
+  }
+  for (std::uint32_t b = 0; b < bucket_count; ++b) {
+    bucket_starts[b + 1] += bucket_starts[b];
+  }
+  indices.resize(points.size());
+  std::vector<std::uint32_t> next(bucket_starts.begin(), bucket_starts.end() - 1);
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    indices[next[point_buckets[i]]++] = i;
+  }
+}
+
+bool PointGrid::is_empty() const {
+  return indices.empty();
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Vector3.hh"
+
+//Spatial hash of points on a uniform grid, a query visits the points of the 27 cells around a position
+//With a cell size equal to a search radius every point closer than that radius is visited, along with a few
+//farther ones that the caller has to discard
+class PointGrid
+{
+public:
+  void build(const std::vector<Point3>& points, double cell_size);
+
+  [[nodiscard]] bool is_empty() const;
+
+  //Calls visitor(index) with the index in the built points of every point near position, each one at most once
+  template <typename Visitor>
+  void for_each_near(const Point3& position, Visitor&& visitor) const;
+
+  //Same for every point closer than a cell size to the box [min, max]
+  template <typename Visitor>
+  void for_each_near(const Point3& min, const Point3& max, Visitor&& visitor) const;
+
+private:
+  [[nodiscard]] std::uint32_t bucket(std::int64_t x, std::int64_t y, std::int64_t z) const;
+
+  double cell_size = 1.0;
+  std::uint32_t bucket_mask = 0;
+  std::vector<std::uint32_t> bucket_starts; //The points of bucket b are indices[bucket_starts[b], bucket_starts[b + 1])
+  std::vector<std::uint32_t> indices;
+};
+
+inline std::uint32_t PointGrid::bucket(std::int64_t x, std::int64_t y, std::int64_t z) const {
+  return static_cast<std::uint32_t>((x * 73856093) ^ (y * 19349663) ^ (z * 83492791)) & bucket_mask;
+}
+
+template <typename Visitor>
+void PointGrid::for_each_near(const Point3& position, Visitor&& visitor) const {
+  if (indices.empty()) {
+    return;
+  }
+  std::int64_t cell_x = std::floor(position.x / cell_size);
+  std::int64_t cell_y = std::floor(position.y / cell_size);
+  std::int64_t cell_z = std::floor(position.z / cell_size);
+  //Two neighbouring cells can share a bucket, it must not be visited twice
+  std::uint32_t visited[27];
+  int visited_count = 0;
+  for (std::int64_t x = cell_x - 1; x <= cell_x + 1; ++x) {
+    for (std::int64_t y = cell_y - 1; y <= cell_y + 1; ++y) {
+      for (std::int64_t z = cell_z - 1; z <= cell_z + 1; ++z) {
+        std::uint32_t current = bucket(x, y, z);
+        bool already_visited = false;
+        for (int i = 0; i < visited_count; ++i) {
+          already_visited |= visited[i] == current;
+        }
+        if (already_visited) {
+          continue;
+        }
+        visited[visited_count++] = current;
+        for (std::uint32_t i = bucket_starts[current]; i < bucket_starts[current + 1]; ++i) {
+          visitor(indices[i]);
+        }
+      }
+    }
+  }
+}
+
+template <typename Visitor>
+void PointGrid::for_each_near(const Point3& min, const Point3& max, Visitor&& visitor) const {
+  if (indices.empty()) {
+    return;
+  }
+  std::int64_t first[3];
+  std::int64_t last[3];
+  double cell_count = 1;
+  for (int axis = 0; axis < 3; ++axis) {
+    first[axis] = std::floor(min[axis] / cell_size) - 1;
+    last[axis] = std::floor(max[axis] / cell_size) + 1;
+    cell_count *= last[axis] - first[axis] + 1;
+  }
+  //A big box covers every bucket anyway
+  if (cell_count >= bucket_starts.size() - 1) {
+    for (std::uint32_t index : indices) {
+      visitor(index);
+    }
+    return;
+  }
+  std::vector<std::uint32_t> buckets;
+  buckets.reserve(cell_count);
+  for (std::int64_t x = first[0]; x <= last[0]; ++x) {
+    for (std::int64_t y = first[1]; y <= last[1]; ++y) {
+      for (std::int64_t z = first[2]; z <= last[2]; ++z) {
+        buckets.push_back(bucket(x, y, z));
+      }
+    }
+  }
+  std::sort(buckets.begin(), buckets.end());
+  buckets.erase(std::unique(buckets.begin(), buckets.end()), buckets.end());
+  for (std::uint32_t current : buckets) {
+    for (std::uint32_t i = bucket_starts[current]; i < bucket_starts[current + 1]; ++i) {
+      visitor(indices[i]);
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#include "PrimitiveGroups.hh"
+
+void PrimitiveGroups::clear() {
+  spheres.clear();
+  planes.clear();
+  triangles.clear();
+  smooth_triangles.clear();
+  others.clear();
+  references.clear();
+}
+
+void PrimitiveGroups::add(const std::shared_ptr<Object>& object) {
+  //The classes of the groups are final, so the dynamic type is exactly the one of the group
+  if (auto sphere = dynamic_cast<const Sphere*>(object.get())) {
+    references.push_back({PrimitiveKind::sphere, static_cast<std::uint32_t>(spheres.size())});
+    spheres.push_back(sphere);
+  } else if (auto plane = dynamic_cast<const Plane*>(object.get())) {
+    references.push_back({PrimitiveKind::plane, static_cast<std::uint32_t>(planes.size())});
+    planes.push_back(plane);
+  } else if (auto triangle = dynamic_cast<const Triangle*>(object.get())) {
+    references.push_back({PrimitiveKind::triangle, static_cast<std::uint32_t>(triangles.size())});
+    triangles.push_back(triangle);
+  } else if (auto smooth_triangle = dynamic_cast<const SmoothTriangle*>(object.get())) {
+    references.push_back({PrimitiveKind::smooth_triangle, static_cast<std::uint32_t>(smooth_triangles.size())});
+    smooth_triangles.push_back(smooth_triangle);
+  } else {
+    references.push_back({PrimitiveKind::other, static_cast<std::uint32_t>(others.size())});
+    others.push_back(object);
+  }
+}
+
+std::size_t PrimitiveGroups::size() const {
+  return references.size();
+}
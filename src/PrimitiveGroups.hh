@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Object.hh"
+
+enum class PrimitiveKind : std::uint8_t
+{
+  sphere,
+  plane,
+  triangle,
+  smooth_triangle,
+  other
+};
+
+//Where a primitive was stored, the kind of its group and its index in it
+struct PrimitiveReference
+{
+  PrimitiveKind kind;
+  std::uint32_t index;
+};
+
+//Scene objects compiled into contiguous arrays of a single type
+//The classes of the groups are final so the loops over them call their methods without going through the vtable,
+//the objects of any other type stay behind their shared_ptr and are called virtually
+//The groups only point to the added objects, which must outlive them, so changes made to the objects are seen
+class PrimitiveGroups
+{
+public:
+  void clear();
+
+  void add(const std::shared_ptr<Object>& object);
+
+  [[nodiscard]] std::size_t size() const;
+
+  //Calls visitor with the concrete type of the primitive-th added object
+  template <typename Visitor>
+  decltype(auto) visit(std::uint32_t primitive, Visitor&& visitor) const;
+
+  //Calls visitor on every primitive, group by group
+  template <typename Visitor>
+  void for_each(Visitor&& visitor) const;
+
+  //Same as for_each but stops at the first primitive for which visitor returns true
+  template <typename Visitor>
+  bool any_of(Visitor&& visitor) const;
+
+  std::vector<const Sphere*> spheres;
+  std::vector<const Plane*> planes;
+  std::vector<const Triangle*> triangles;
+  std::vector<const SmoothTriangle*> smooth_triangles;
+  std::vector<std::shared_ptr<Object>> others;
+  std::vector<PrimitiveReference> references; //In the order of add
+};
+
+template <typename Visitor>
+decltype(auto) PrimitiveGroups::visit(std::uint32_t primitive, Visitor&& visitor) const {
+  const PrimitiveReference& reference = references[primitive];
+  switch (reference.kind) {
+    case PrimitiveKind::sphere:
+      return visitor(*spheres[reference.index]);
+    case PrimitiveKind::plane:
+      return visitor(*planes[reference.index]);
+    case PrimitiveKind::triangle:
+      return visitor(*triangles[reference.index]);
+    case PrimitiveKind::smooth_triangle:
+      return visitor(*smooth_triangles[reference.index]);
+    default:
+      return visitor(static_cast<const Object&>(*others[reference.index]));
+  }
+}
+
+template <typename Visitor>
+void PrimitiveGroups::for_each(Visitor&& visitor) const {
+  any_of([&](const auto& object) {
+    visitor(object);
+    return false;
+  });
+}
+
+template <typename Visitor>
+bool PrimitiveGroups::any_of(Visitor&& visitor) const {
+  auto any_of_group = [&](const auto& group) {
+    for (const auto* object : group) {
+      if (visitor(*object)) {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (any_of_group(spheres) || any_of_group(planes) || any_of_group(triangles) || any_of_group(smooth_triangles)) {
+    return true;
+  }
+  for (const auto& object : others) {
+    if (visitor(static_cast<const Object&>(*object))) {
+      return true;
+    }
+  }
+  return false;
+}
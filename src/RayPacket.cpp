@@ -0,0 +1,74 @@
+#include "RayPacket.hh"
+#include <limits>
+
+RayPacket::RayPacket(const std::array<Rayon, packet_size>& rays, int count)
+    : count(count)
+{
+  auto lane = [&](int i) { return rays[i < count ? i : count - 1]; };
+  origin = {Double4(lane(0).origin.x, lane(1).origin.x, lane(2).origin.x, lane(3).origin.x)
+            , Double4(lane(0).origin.y, lane(1).origin.y, lane(2).origin.y, lane(3).origin.y)
+            , Double4(lane(0).origin.z, lane(1).origin.z, lane(2).origin.z, lane(3).origin.z)};
+  direction = {Double4(lane(0).direction.x, lane(1).direction.x, lane(2).direction.x, lane(3).direction.x)
+               , Double4(lane(0).direction.y, lane(1).direction.y, lane(2).direction.y, lane(3).direction.y)
+               , Double4(lane(0).direction.z, lane(1).direction.z, lane(2).direction.z, lane(3).direction.z)};
+  Double4 one(1.0);
+  inv_direction = {one / direction.x, one / direction.y, one / direction.z};
+}
+
+Rayon RayPacket::ray(int lane) const {
+  Rayon ray(Vector3(direction.x[lane], direction.y[lane], direction.z[lane])
+            , Point3(origin.x[lane], origin.y[lane], origin.z[lane]));
+  //Normalizing again could change the last bits and make the packet disagree with the scalar path
+  ray.direction = Vector3(direction.x[lane], direction.y[lane], direction.z[lane]);
+  return ray;
+}
+
+PacketHit::PacketHit()
+    : t(Double4(std::numeric_limits<double>::infinity()))
+    , objects{}
+    , hits{}
+{}
+
+void PacketHit::record(Mask4 closer, Double4 t, Double4 u, Double4 v, const Object* object, std::uint32_t primitive_id) {
+  int lanes = bits(closer);
+  if (lanes == 0) {
+    return;
+  }
+  this->t = select(closer, t, this->t);
+  for (int lane = 0; lane < packet_size; ++lane) {
+    if (lanes & (1 << lane)) {
+      objects[lane] = object;
+      hits[lane] = HitRecord{t[lane], u[lane], v[lane], primitive_id};
+    }
+  }
+}
+
+void PacketHit::record(int lane, const HitRecord& hit, const Object* object) {
+  double lanes[packet_size] = {t[0], t[1], t[2], t[3]};
+  lanes[lane] = hit.t;
+  t = Double4(lanes[0], lanes[1], lanes[2], lanes[3]);
+  objects[lane] = object;
+  hits[lane] = hit;
+}
+
+Mask4 intersect_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const RayPacket& packet, double t_min,
+                         Double4 t_max, double epsilon, Double4& t, Double4& u, Double4& v) {
+  Vector3x4 ab = {Double4(AB.x), Double4(AB.y), Double4(AB.z)};
+  Vector3x4 ac = {Double4(AC.x), Double4(AC.y), Double4(AC.z)};
+  Vector3x4 a = {Double4(A.x), Double4(A.y), Double4(A.z)};
+  Vector3x4 P = cross(packet.direction, ac);
+  Double4 determinant = dot(P, ab);
+  Mask4 valid = abs(determinant) >= Double4(epsilon);
+  Double4 invDeterminant = Double4(1.0) / determinant;
+  Vector3x4 AO = packet.origin - a;
+  u = invDeterminant * dot(AO, P);
+  valid = valid & (u >= Double4(0.0)) & (u <= Double4(1.0));
+  if (!any(valid)) {
+    return valid;
+  }
+  Vector3x4 Q = cross(AO, ab);
+  v = invDeterminant * dot(packet.direction, Q);
+  valid = valid & (v >= Double4(0.0)) & (u + v <= Double4(1.0));
+  t = invDeterminant * dot(ac, Q);
+  return valid & (t > Double4(t_min)) & (t < t_max);
+}
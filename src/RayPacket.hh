@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include "HitRecord.hh"
+#include "Rayon.hh"
+#include "Simd.hh"
+
+class Object;
+
+constexpr int packet_size = 4;
+
+//Neighbouring rays traced together, one per lane
+//Packets of less than packet_size rays repeat their last ray in the unused lanes, whose results are ignored
+struct RayPacket
+{
+  RayPacket(const std::array<Rayon, packet_size>& rays, int count);
+
+  [[nodiscard]] Rayon ray(int lane) const;
+
+  Vector3x4 origin;
+  Vector3x4 direction;
+  Vector3x4 inv_direction;
+  int count;
+};
+
+//Closest hit of every lane of a packet
+struct PacketHit
+{
+  PacketHit();
+
+  //Keeps the lanes of closer, whose t the caller already checked to be closer than this->t
+  void record(Mask4 closer, Double4 t, Double4 u, Double4 v, const Object* object, std::uint32_t primitive_id = 0);
+  void record(int lane, const HitRecord& hit, const Object* object);
+
+  Double4 t; //Infinity on the lanes without hit
+  std::array<const Object*, packet_size> objects;
+  std::array<HitRecord, packet_size> hits;
+};
+
+//Moller Trumbore on the four lanes at once, fills t, u and v and returns the lanes that hit with t_min < t < t_max
+Mask4 intersect_triangle(const Point3& A, const Vector3& AB, const Vector3& AC, const RayPacket& packet, double t_min,
+                         Double4 t_max, double epsilon, Double4& t, Double4& u, Double4& v);
@@ -1,5 +1,10 @@
 #include "Rayon.hh"
 
+Rayon::Rayon()
+ : direction(Vector3())
+ , origin(Point3())
+{}
+
 Rayon::Rayon(Vector3 direction, Point3 origin)
  : direction(direction.normalize())
  , origin(origin)
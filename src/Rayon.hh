@@ -5,8 +5,12 @@
 class Rayon
 {
 public:
+    Rayon();
     Rayon(Vector3 direction, Point3 origin);
 
     Vector3 direction;
     Point3 origin;
+    //The ray stands for a cone of this width at the origin, growing by spread per unit of distance
+    double width = 0;
+    double spread = 0;
 };
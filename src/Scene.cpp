@@ -2,8 +2,14 @@
 #include <iostream>
 #include <cmath>
 #include <random>
+#include <limits>
+#include <mutex>
+#include <algorithm>
+#include <atomic>
 
 #include "Vector3.hh"
+#include "ThreadPool.hh"
+#include "TextureCache.hh"
 
 Scene::Scene(Camera camera, unsigned int max_bounces)
     : camera(camera)
@@ -13,24 +19,42 @@ Scene::Scene(Camera camera, unsigned int max_bounces)
 PointIntersection::PointIntersection()
     : is_intersecting(false)
     , intersecting_object(nullptr)
+    , hit(HitRecord())
     , intersection_point(Point3())
+    , normal(Vector3())
     , caracteristics(Caracteristics())
 {}
 
-PointIntersection::PointIntersection(bool is_intersecting, std::shared_ptr<Object> intersecting_object,
-                                     Point3 intersection_point, Caracteristics caracteristics)
+PointIntersection::PointIntersection(bool is_intersecting, const Object* intersecting_object, HitRecord hit,
+                                     Point3 intersection_point, Vector3 normal, Caracteristics caracteristics)
     : is_intersecting(is_intersecting)
     , intersecting_object(intersecting_object)
+    , hit(hit)
     , intersection_point(intersection_point)
+    , normal(normal)
     , caracteristics(caracteristics){}
 
+//The footprint of the hit is the width of the cone of the ray where it meets the surface, stretched by its slant up to
+//a limit since the textures filter the same amount in every direction
+static PointIntersection resolve_hit(const Rayon& ray, const Object* intersecting_object, HitRecord hit) {
+  Point3 intersection_point = ray.origin + ray.direction * hit.t;
+  Vector3 normal = intersecting_object->normal_at_point(hit, intersection_point, ray);
+  double cosine = std::fabs(ray.direction.scalar_product(normal)) / normal.norm();
+  //A degenerate normal gives a NaN cosine, max keeps the limit then
+  hit.footprint = (ray.width + ray.spread * hit.t) / std::max(0.125, cosine);
+  Caracteristics caracteristics = intersecting_object->texture_at_point(hit, intersection_point);
+  return PointIntersection(true, intersecting_object, hit, intersection_point, normal, caracteristics);
+}
+
 
 void Scene::add_object(const std::vector<std::shared_ptr<Object>>& objects_to_add) {
   objects.insert(objects.end(), objects_to_add.begin(), objects_to_add.end());
+  acceleration_built = false;
 }
 
 Scene& Scene::add_object(std::shared_ptr<Object> object) {
   objects.push_back(object);
+  acceleration_built = false;
   return *this;
 }
 
@@ -43,58 +67,141 @@ void Scene::set_epsilon(double epsilon) {
   this->epsilon = epsilon;
 }
 
-bool Scene::is_hidden(const Rayon& ray, double max_t) {
+void Scene::build_acceleration() {
+  bounded_primitives.clear();
+  unbounded_primitives.clear();
+  std::vector<BoundingBox> boxes;
+  for (const auto& object : this->objects) {
+    auto box = object->bounding_box();
+    if (box) {
+      bounded_primitives.add(object);
+      boxes.push_back(box.value());
+    } else {
+      unbounded_primitives.add(object);
+    }
+  }
+  bvh.build(boxes);
+  built_surface_area = bvh.total_surface_area();
+  acceleration_built = true;
+}
+
+void Scene::refit_acceleration() {
+  if (!acceleration_built) {
+    build_acceleration();
+    return;
+  }
+  std::vector<BoundingBox> boxes(bounded_primitives.size());
+  for (std::uint32_t primitive = 0; primitive < boxes.size(); ++primitive) {
+    boxes[primitive] = bounded_primitives.visit(primitive, [](const auto& object) {
+      return object.bounding_box().value_or(BoundingBox());
+    });
+  }
+  bvh.refit(boxes);
+  if (bvh.total_surface_area() > max_refit_growth * built_surface_area) {
+    build_acceleration();
+  }
+}
+
+ShadowStatistics& ShadowStatistics::operator+=(const ShadowStatistics& other) {
+  shadow_rays += other.shadow_rays;
+  occluded += other.occluded;
+  cache_hits += other.cache_hits;
+  return *this;
+}
+
+std::ostream& operator<<(std::ostream& out, const ShadowStatistics& statistics) {
+  out << "Shadow rays : " << statistics.shadow_rays << " Occluded : " << statistics.occluded
+      << " Occluder cache hits : " << statistics.cache_hits;
+  if (statistics.occluded > 0) {
+    out << " (" << 100.0 * statistics.cache_hits / statistics.occluded << "% of the occluded rays)";
+  }
+  return out << '\n';
+}
+
+bool Scene::is_hidden(const Rayon& ray, double max_t, std::size_t light_index, TraceContext& context) {
   if (!shadow) {
     return false;
   }
+  if (!acceleration_built) {
+    build_acceleration();
+  }
+  if (context.last_occluders.size() < lights.size()) {
+    context.last_occluders.resize(lights.size(), nullptr);
+  }
+  ++context.shadow_statistics.shadow_rays;
 
-  std::shared_ptr<Object> intersecting_object;
-  for (const auto& object : this->objects) {
-    if (object->texture_material->caracteristics.index_refraction.has_value()) {
-      continue; //We can reach the light eventhough we intersect with a transparent object
-    }
-    std::optional<double> t = object->is_intersecting(ray);
-    if (t) {
-      //With t > this->epsilon, and epsilon > 0 we are sure we won't find an intersection behind ourselves
-      //with t < max_t, we won't find an intersection behind a light when we want to know if we are in the shadows
-      if (t > this->epsilon) {
-        if (t > max_t - this->epsilon) {
-          continue;
-        }
-        return true;
-      }
+  //With t > this->epsilon, and epsilon > 0 we are sure we won't find an intersection behind ourselves
+  //with t < max_t, we won't find an intersection behind a light when we want to know if we are in the shadows
+  double t_max = max_t - this->epsilon;
+  const Object*& last_occluder = context.last_occluders[light_index];
+  if (last_occluder != nullptr && last_occluder->is_occluding(ray, this->epsilon, t_max)) {
+    ++context.shadow_statistics.occluded;
+    ++context.shadow_statistics.cache_hits;
+    return true;
+  }
+
+  auto occlude = [&](const auto& object) {
+    if (object.texture_material->caracteristics.index_refraction.has_value()) {
+      return false; //We can reach the light eventhough we intersect with a transparent object
+    }
+    if (object.is_occluding(ray, this->epsilon, t_max)) {
+      last_occluder = &object;
+      return true;
     }
+    return false;
+  };
+  bool hidden = unbounded_primitives.any_of(occlude);
+  if (!hidden) {
+    hidden = bvh.find_any(ray, max_t, [&](std::uint32_t primitive) {
+      return bounded_primitives.visit(primitive, occlude);
+    });
+  }
+  if (hidden) {
+    ++context.shadow_statistics.occluded;
   }
-  return false;
+  return hidden;
 }
 
-Pixel Scene::diffuse_light(const Point3& intersection_point, const Vector3& normal, const Caracteristics& caracteristics) {
-  Pixel diffuse_intensity(0,0,0);
-  for (const auto& light : this->lights) {
-    Vector3 point_to_light_vector = Vector3(intersection_point, light->origin);
-    double point_to_light_norm = point_to_light_vector.norm();
-    Vector3 point_to_light = point_to_light_vector.normalize();
-    if (is_hidden(Rayon(point_to_light, intersection_point),  point_to_light_norm)) {continue;}
+LightSample Scene::sample_light(const Point3& intersection_point, std::size_t light_index, TraceContext& context) {
+  const auto& light = this->lights[light_index];
+  Vector3 point_to_light_vector = Vector3(intersection_point, light->origin);
+  double point_to_light_norm = point_to_light_vector.norm();
+  Vector3 point_to_light = point_to_light_vector.normalize();
+  bool visible = !is_hidden(Rayon(point_to_light, intersection_point), point_to_light_norm, light_index, context);
+  return LightSample{light.get(), point_to_light, point_to_light_norm, visible};
+}
 
-    diffuse_intensity += (caracteristics.pixel * caracteristics.kd * light->colors)
-                         * normal.scalar_product(point_to_light, true);
-  }
-  return diffuse_intensity;
+Pixel Scene::diffuse_term(const LightSample& sample, const Vector3& normal, const Caracteristics& caracteristics) const {
+  return (caracteristics.pixel * caracteristics.kd * sample.light->colors)
+         * normal.positive_scalar_product(sample.point_to_light);
 }
 
-Pixel Scene::specular_light(const Point3& intersection_point, const Vector3& reflected_vector, const Caracteristics& caracteristics) {
-  Pixel specular_intensity(0,0,0);
-  for (const auto& light : this->lights) {
-    Vector3 point_to_light_vector = Vector3(intersection_point, light->origin);
-    double point_to_light_norm = point_to_light_vector.norm();
-    Vector3 point_to_light = point_to_light_vector.normalize();
-    if (is_hidden(Rayon(point_to_light, intersection_point),  point_to_light_norm)) {continue;}
+Pixel Scene::specular_term(const LightSample& sample, const Vector3& reflected_vector,
+                           const Caracteristics& caracteristics) const {
+  //TODO try to remove this, added a 10 times coefficient otherwise we did not see the specular light
+  return caracteristics.ks * std::pow(reflected_vector.positive_scalar_product(sample.point_to_light), caracteristics.ns)
+         * sample.light->colors;
+}
 
-    specular_intensity += caracteristics.ks
-                          * std::pow(reflected_vector.scalar_product(point_to_light, true), caracteristics.ns) * light->colors;
-    //TODO try to remove this, added a 10 times coefficient otherwise we did not see the specular light
+Pixel Scene::direct_light(const Point3& intersection_point, const Vector3& normal, const Vector3& reflected_vector,
+                          const Caracteristics& caracteristics, TraceContext& context) {
+  Pixel intensity(0,0,0);
+  if (!diffusion && !specularity) {
+    return intensity;
   }
-  return specular_intensity;
+  for (std::size_t light_index = 0; light_index < this->lights.size(); ++light_index) {
+    LightSample sample = sample_light(intersection_point, light_index, context);
+    if (!sample.visible) {
+      continue;
+    }
+    if (diffusion) {
+      intensity += diffuse_term(sample, normal, caracteristics);
+    }
+    if (specularity) {
+      intensity += specular_term(sample, reflected_vector, caracteristics);
+    }
+  }
+  return intensity;
 }
 
 double Scene::fresnel(const Vector3& incident, const Vector3& normal, double index_refraction) {
@@ -125,39 +232,92 @@ double Scene::fresnel(const Vector3& incident, const Vector3& normal, double ind
 
 //TODO unify the method for shadow acneing between find_intersection and is_hidden
 PointIntersection Scene::find_intersection(Rayon ray) {
+  if (!acceleration_built) {
+    build_acceleration();
+  }
   // for reflection and refraction instead of discarding small t, translate the origin of the ray along the ray normal
   ray.origin = ray.origin + ray.direction * epsilon;
-  std::optional<double> t_min;
-  std::shared_ptr<Object> intersecting_object;
-  for (const auto& object : this->objects) {
-    std::optional<double> t = object->is_intersecting(ray);
-    if (t) {
-      //With t > this->epsilon, and epsilon > 0 we are sure we won't find an intersection behind ourselves
-      if (t > this->epsilon && (!t_min || t < t_min.value())) {
-        t_min = t;
-        intersecting_object = object;
-      }
-      //if (!t_min || t < t_min.value()) {
-      //  t_min = t;
-      //  intersecting_object = object;
-      //}
+  double t_min = std::numeric_limits<double>::infinity();
+  const Object* intersecting_object = nullptr;
+  HitRecord closest_hit;
+  auto intersect = [&](const auto& object, double& t_max) {
+    //With t > this->epsilon, and epsilon > 0 we are sure we won't find an intersection behind ourselves
+    std::optional<HitRecord> hit = object.find_nearest(ray, this->epsilon, t_max);
+    if (hit) {
+      t_max = hit->t;
+      closest_hit = hit.value();
+      intersecting_object = &object;
+      return true;
     }
-  }
+    return false;
+  };
+  unbounded_primitives.for_each([&](const auto& object) { intersect(object, t_min); });
+  bvh.find_nearest(ray, t_min, [&](std::uint32_t primitive, double& t_max) {
+    return bounded_primitives.visit(primitive, [&](const auto& object) { return intersect(object, t_max); });
+  });
   if (intersecting_object == nullptr) {
     return PointIntersection();
   }
-  Point3 intersection_point = ray.origin + ray.direction * t_min.value();
-  Caracteristics caracteristics = intersecting_object->texture_at_point(intersection_point);
-  return PointIntersection(true, intersecting_object, intersection_point, caracteristics);
+  return resolve_hit(ray, intersecting_object, closest_hit);
+}
+
+std::array<PointIntersection, packet_size> Scene::find_intersection(const std::array<Rayon, packet_size>& rays,
+                                                                    int count) {
+  if (!acceleration_built) {
+    build_acceleration();
+  }
+  std::array<Rayon, packet_size> moved_rays = rays;
+  for (auto& ray : moved_rays) {
+    ray.origin = ray.origin + ray.direction * epsilon;
+  }
+  RayPacket packet(moved_rays, count);
+  PacketHit closest;
+  auto intersect = [&](const auto& object) { object.intersect_packet(packet, this->epsilon, closest); };
+  unbounded_primitives.for_each(intersect);
+  bvh.find_nearest(packet, closest, [&](std::uint32_t primitive) { bounded_primitives.visit(primitive, intersect); });
+
+  std::array<PointIntersection, packet_size> intersections;
+  for (int lane = 0; lane < count; ++lane) {
+    const Object* intersecting_object = closest.objects[lane];
+    if (intersecting_object == nullptr) {
+      continue;
+    }
+    intersections[lane] = resolve_hit(moved_rays[lane], intersecting_object, closest.hits[lane]);
+  }
+  return intersections;
 }
 
 
-//TODO do not clamp before the end, use reinhard function to clamp or gamma
 Pixel Scene::raycast(const Rayon& ray, unsigned int bounces) {
+  TraceContext context;
+  Pixel result = this->raycast(ray, bounces, context);
+  shadow_statistics += context.shadow_statistics;
+  return result;
+}
+
+Pixel Scene::raycast(const Rayon& ray, unsigned int bounces, TraceContext& context) {
   if (bounces == 0) {
     return Pixel(0,0,0);
   }
-  PointIntersection struct_intersection = this->find_intersection(ray);
+  return this->shade(ray, this->find_intersection(ray), bounces, context);
+}
+
+std::array<Pixel, packet_size> Scene::raycast(const std::array<Rayon, packet_size>& rays, int count,
+                                              unsigned int bounces, TraceContext& context) {
+  std::array<Pixel, packet_size> pixels;
+  if (bounces == 0) {
+    return pixels;
+  }
+  auto intersections = this->find_intersection(rays, count);
+  //Secondary rays are not coherent anymore, they go through the scalar path
+  for (int lane = 0; lane < count; ++lane) {
+    pixels[lane] = this->shade(rays[lane], intersections[lane], bounces, context);
+  }
+  return pixels;
+}
+
+Pixel Scene::shade(const Rayon& ray, const PointIntersection& struct_intersection, unsigned int bounces,
+                   TraceContext& context) {
   if (!struct_intersection.is_intersecting) {
     return Pixel(0, 0, 0);
   }
@@ -165,11 +325,17 @@ Pixel Scene::raycast(const Rayon& ray, unsigned int bounces) {
   Caracteristics caracteristics = struct_intersection.caracteristics;
   bool transparent = refraction && caracteristics.index_refraction.has_value();
   auto intersection_point = struct_intersection.intersection_point;
-  auto intersecting_object = struct_intersection.intersecting_object;
 
-  Vector3 normal = intersecting_object->normal_at_point(intersection_point, ray);
+  Vector3 normal = struct_intersection.normal;
   Vector3 incident_vector = (Vector3(ray.origin, intersection_point)).normalize();
   Vector3 reflected_vector = reflection_vector(incident_vector, normal);
+  //The cones of the secondary rays go on from the footprint of this one, the curvature of the surface is ignored
+  auto secondary_ray = [&](const Vector3& direction) {
+    Rayon secondary(direction, intersection_point);
+    secondary.width = struct_intersection.hit.footprint;
+    secondary.spread = ray.spread;
+    return secondary;
+  };
 
   if (transparent) {
     double kr = this->fresnel(incident_vector, normal, caracteristics.index_refraction.value());
@@ -177,60 +343,175 @@ Pixel Scene::raycast(const Rayon& ray, unsigned int bounces) {
     if (kr < 1.0) {
       auto refraction_vec = refraction_vector(incident_vector, normal, caracteristics.index_refraction.value());
       //We should not be in the case of TIR because kr < 1.0
-      refrac = this->raycast(Rayon(refraction_vec.value(), intersection_point), bounces - 1);
+      refrac = this->raycast(secondary_ray(refraction_vec.value()), bounces - 1, context);
     }
-    Pixel reflex = caracteristics.ks * this->raycast(Rayon(reflected_vector, intersection_point), bounces - 1);
+    Pixel reflex = caracteristics.ks * this->raycast(secondary_ray(reflected_vector), bounces - 1, context);
     result += reflex * kr + refrac * (1.0 - kr);
   }
   else {
-    if (diffusion) {
-      result += this->diffuse_light(intersection_point, normal, caracteristics);
-    }
-    if (specularity) {
-      result += this->specular_light(intersection_point, reflected_vector, caracteristics);
-    }
+    result += this->direct_light(intersection_point, normal, reflected_vector, caracteristics, context);
     if (reflection) {
-      result += caracteristics.ks * this->raycast(Rayon(reflected_vector, intersection_point), bounces - 1);
+      result += caracteristics.ks * this->raycast(secondary_ray(reflected_vector), bounces - 1, context);
     }
   }
   return result;
 }
 
+Rayon Scene::primary_ray(const Point3& location) const {
+  Vector3 direction(this->camera.center, location);
+  Rayon ray(direction, this->camera.center);
+  //A pixel seen from the camera
+  ray.spread = this->camera.unit_x_vector.norm() / direction.norm();
+  return ray;
+}
+
+Pixel Scene::render_pixel(const Point3& pixel_location, std::size_t pixel_index, TraceContext& context) {
+  if (this->msaa_samples == 1) {
+    return this->raycast(primary_ray(pixel_location), this->max_bounces, context);
+  }
+  std::seed_seq pixel_seed{this->seed, static_cast<unsigned int>(pixel_index)};
+  std::mt19937 gen(pixel_seed);
+  std::uniform_real_distribution<> distr(-0.5, 0.5); // define the range
+  double red = 0.0, green = 0.0, blue = 0.0;
+  std::array<Rayon, packet_size> rays;
+  int count = 0;
+  auto trace = [&]() {
+    std::array<Pixel, packet_size> pixels;
+    if (count == 1) {
+      pixels[0] = this->raycast(rays[0], this->max_bounces, context);
+    } else {
+      pixels = this->raycast(rays, count, this->max_bounces, context);
+    }
+    for (int lane = 0; lane < count; ++lane) {
+      red += pixels[lane].x;
+      green += pixels[lane].y;
+      blue += pixels[lane].z;
+    }
+    count = 0;
+  };
+  //The samples of a pixel are close to each other, they are traced by packets
+  for (int i = 0; i < this->msaa_samples; ++i) {
+    auto random_location = pixel_location + distr(gen) * this->camera.unit_x_vector + distr(gen) * this->camera.unit_y_vector;
+    rays[count++] = primary_ray(random_location);
+    if (count == packet_size || !packet_tracing) {
+      trace();
+    }
+  }
+  if (count > 0) {
+    trace();
+  }
+  red /= this->msaa_samples;
+  green /= this->msaa_samples;
+  blue /= this->msaa_samples;
+  return Pixel(red, green, blue);
+}
+
+void Scene::render_tile(Image& image, const std::vector<Point3>& pixels_location, int x_begin, int y_begin, int x_end,
+                        int y_end, TraceContext& context) {
+  if (!packet_tracing || this->msaa_samples > 1) {
+    for (int y = y_begin; y < y_end; ++y) {
+      for (int x = x_begin; x < x_end; ++x) {
+        std::size_t index = y * width + x;
+        image.pixels[index] = this->render_pixel(pixels_location[index], index, context);
+      }
+    }
+    return;
+  }
+  //Without msaa the packets are 2x2 blocks of pixels
+  for (int y = y_begin; y < y_end; y += 2) {
+    for (int x = x_begin; x < x_end; x += 2) {
+      std::array<std::size_t, packet_size> indices;
+      std::array<Rayon, packet_size> rays;
+      int count = 0;
+      for (int block_y = y; block_y < std::min(y + 2, y_end); ++block_y) {
+        for (int block_x = x; block_x < std::min(x + 2, x_end); ++block_x) {
+          indices[count] = block_y * width + block_x;
+          rays[count] = primary_ray(pixels_location[indices[count]]);
+          ++count;
+        }
+      }
+      auto pixels = this->raycast(rays, count, this->max_bounces, context);
+      for (int lane = 0; lane < count; ++lane) {
+        image.pixels[indices[lane]] = pixels[lane];
+      }
+    }
+  }
+}
 Image Scene::raycasting() {
+  return render(nullptr);
+}
+
+Image Scene::raycasting(ImageSink& sink) {
+  return render(&sink);
+}
+
+Image Scene::render(ImageSink* sink) {
+  //No texture is looked up yet, the cache can evict the ones past its budget unless another scene is rendering
+  TextureCache::RenderGuard texture_render(TextureCache::instance());
   Image image(width, height);
+  image.pixels.resize(width * height);
   auto pixels_location = this->camera.pixels_location(width, height);
-  std::random_device rd; // obtain a random number from hardware
-  std::mt19937 gen(rd()); // seed the generator
-  std::uniform_real_distribution<> distr(-0.5, 0.5); // define the range
-  int loading = 0;
+  //Built before the workers start since they all share it
+  if (!acceleration_built) {
+    build_acceleration();
+  }
+
+  int tiles_x = (width + tile_size - 1) / tile_size;
+  int tiles_y = (height + tile_size - 1) / tile_size;
   int nb_pixels = height * width;
+  int loading = 0;
   int displayed = 0;
-  for (const auto& pixel_location : pixels_location) {
-    if (this->msaa_samples == 1) {
-      Rayon ray(Vector3(this->camera.center, pixel_location).normalize(), this->camera.center);
-      auto pixel = this->raycast(ray, this->max_bounces);
-      image.pixels.push_back(pixel);
-      continue;
+  std::mutex progress_mutex;
+
+  std::atomic<std::size_t> next_tile{0};
+  std::vector<int> band_remaining(tiles_y, tiles_x); //Tiles left to render in each row of tiles
+  int next_band = 0;
+  bool sink_writing = false; //Stays set if write_rows throws, so nothing is written past the failed band
+  std::mutex sink_mutex;
+  if (sink) {
+    sink->begin(width, height);
+  }
+
+  ThreadPool pool(this->threads);
+  std::vector<TraceContext> contexts(pool.size());
+  pool.parallel_for(tiles_x * tiles_y, [&](std::size_t task, unsigned int worker) {
+    std::size_t tile = sink ? next_tile++ : task;
+    int x_begin = (tile % tiles_x) * tile_size;
+    int y_begin = (tile / tiles_x) * tile_size;
+    int x_end = std::min(x_begin + tile_size, width);
+    int y_end = std::min(y_begin + tile_size, height);
+    this->render_tile(image, pixels_location, x_begin, y_begin, x_end, y_end, contexts[worker]);
+    if (sink) {
+      //The pixels of the other tiles of a band were written before their worker took this lock
+      std::unique_lock<std::mutex> lock(sink_mutex);
+      --band_remaining[tile / tiles_x];
+      //One worker at a time claims the completed bands and writes them outside the lock, in order, the workers that
+      //complete bands meanwhile leave them to it and go back to rendering
+      if (!sink_writing) {
+        sink_writing = true;
+        while (next_band < tiles_y && band_remaining[next_band] == 0) {
+          int band_begin = next_band++ * tile_size;
+          int band_end = std::min(band_begin + tile_size, height);
+          lock.unlock();
+          sink->write_rows(&image.pixels[static_cast<std::size_t>(band_begin) * width], band_begin, band_end);
+          lock.lock();
+        }
+        sink_writing = false;
+      }
     }
-    double red = 0.0, green = 0.0, blue = 0.0;
-    for (int i = 0; i < this->msaa_samples; ++i) {
-      auto random_location = pixel_location + distr(gen) * this->camera.unit_x_vector + distr(gen) * this->camera.unit_y_vector;
-      Rayon ray(Vector3(this->camera.center, random_location).normalize(), this->camera.center);
-      auto pixel = this->raycast(ray, this->max_bounces);
-      red += pixel.x;
-      green += pixel.y;
-      blue += pixel.z;
-    }
-    red /= this->msaa_samples;
-    green /= this->msaa_samples;
-    blue /= this->msaa_samples;
-    image.pixels.emplace_back(red, green, blue);
-    ++loading;
+    std::lock_guard<std::mutex> lock(progress_mutex);
+    loading += (x_end - x_begin) * (y_end - y_begin);
     int percentage = 100 * loading / nb_pixels;
-    if (percentage > displayed) {
+    while (percentage > displayed) {
       std::cout << ' ' << displayed << ' ' << std::flush;
       ++displayed;
     }
+  });
+  if (sink) {
+    sink->end();
+  }
+  for (const auto& context : contexts) {
+    shadow_statistics += context.shadow_statistics;
   }
   return image;
 }
@@ -1,23 +1,60 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <ostream>
 #include <vector>
 #include "Object.hh"
 #include "Image.hh"
+#include "ImageSink.hh"
 #include "Camera.hh"
 #include "Light.hh"
+#include "BVH.hh"
+#include "PrimitiveGroups.hh"
 
 struct PointIntersection
 {
     PointIntersection();
-    PointIntersection(bool is_intersecting,  std::shared_ptr<Object> intersecting_object, Point3 intersection_point,
-                      Caracteristics caracteristics);
+    PointIntersection(bool is_intersecting, const Object* intersecting_object, HitRecord hit, Point3 intersection_point,
+                      Vector3 normal, Caracteristics caracteristics);
 
     bool is_intersecting;
-    std::shared_ptr<Object> intersecting_object;
+    //Not a shared_ptr, copying one from every thread for every hit would make them fight over the reference count
+    const Object* intersecting_object;
+    HitRecord hit;
     Point3 intersection_point;
+    Vector3 normal; //Facing the ray that found the point
     Caracteristics caracteristics;
 };
 
+struct ShadowStatistics
+{
+    ShadowStatistics& operator+=(const ShadowStatistics& other);
+
+    std::uint64_t shadow_rays = 0;
+    std::uint64_t occluded = 0;
+    std::uint64_t cache_hits = 0; //Shadow rays stopped by the cached occluder without going through the BVH
+};
+
+std::ostream& operator<<(std::ostream& out, const ShadowStatistics& statistics);
+
+//State of one tracing thread, never shared between workers
+struct TraceContext
+{
+    //Last object that blocked each light, tested before anything else since neighbouring hits are often hidden by it
+    std::vector<const Object*> last_occluders = {};
+    ShadowStatistics shadow_statistics;
+};
+
+//What a hit point sees of one light
+struct LightSample
+{
+    const Light* light;
+    Vector3 point_to_light; //Normalized
+    double distance;
+    bool visible;
+};
+
 class Scene
 {
 public:
@@ -27,25 +64,73 @@ public:
     void add_object(const std::vector<std::shared_ptr<Object>>& objects_to_add);
     Scene& add_light(std::shared_ptr<Light> light);
 
-    bool is_hidden(const Rayon& ray, double point_to_light_norm);
+    //Compiles the objects into groups of a single type, for the BVH and for the unbounded ones
+    //Done lazily by the first query after an add_object
+    void build_acceleration();
 
-    Pixel diffuse_light(const Point3& intersection_point, const Vector3& normal, const Caracteristics& caracteristics);
+    //Moves the boxes of the BVH to the current bounding boxes of the objects instead of building it again
+    //Builds from scratch when objects were added since the last build or when the refitted BVH got too loose
+    void refit_acceleration();
 
-    Pixel specular_light(const Point3& intersection_point, const Vector3& reflected_vector, const Caracteristics& caracteristics);
+    bool is_hidden(const Rayon& ray, double point_to_light_norm, std::size_t light_index, TraceContext& context);
+
+    //Direction, distance and visibility of one light, traced once per hit point and light
+    LightSample sample_light(const Point3& intersection_point, std::size_t light_index, TraceContext& context);
+
+    Pixel diffuse_term(const LightSample& sample, const Vector3& normal, const Caracteristics& caracteristics) const;
+
+    Pixel specular_term(const LightSample& sample, const Vector3& reflected_vector,
+                        const Caracteristics& caracteristics) const;
+
+    //Single pass over the lights, every term of the shading uses the same LightSample so a new term does not need
+    //its own shadow rays
+    Pixel direct_light(const Point3& intersection_point, const Vector3& normal, const Vector3& reflected_vector,
+                       const Caracteristics& caracteristics, TraceContext& context);
 
     //This function returns the ratio of energy that is reflected, between 0 and 1
     double fresnel(const Vector3& incident, const Vector3& normal, double index_refraction);
 
     PointIntersection find_intersection(Rayon ray);
 
+    //Traces the first count rays together through the SIMD packet path
+    std::array<PointIntersection, packet_size> find_intersection(const std::array<Rayon, packet_size>& rays, int count);
+
+    //Renders the image tile by tile on `threads` workers, the result only depends on `seed`
     Image raycasting();
 
+    //Same image, the bands of tile_size rows are also handed to sink in order as soon as all their tiles are done
+    //The tiles are then taken in raster order by whichever worker is free, so the bands complete one after the other
+    Image raycasting(ImageSink& sink);
+
+    //Color of one pixel, the msaa jitter is drawn from a generator seeded with the seed and the pixel index
+    Pixel render_pixel(const Point3& pixel_location, std::size_t pixel_index, TraceContext& context);
+
+    void render_tile(Image& image, const std::vector<Point3>& pixels_location, int x_begin, int y_begin, int x_end,
+                     int y_end, TraceContext& context);
+
+    Rayon primary_ray(const Point3& location) const;
+
+    //Uses a temporary context whose statistics are added to shadow_statistics
     Pixel raycast(const Rayon& ray, unsigned int bounces);
+    Pixel raycast(const Rayon& ray, unsigned int bounces, TraceContext& context);
+    std::array<Pixel, packet_size> raycast(const std::array<Rayon, packet_size>& rays, int count, unsigned int bounces,
+                                           TraceContext& context);
+
+    //Color seen by ray once its intersection is known, the reflected and refracted rays are traced one by one
+    Pixel shade(const Rayon& ray, const PointIntersection& struct_intersection, unsigned int bounces,
+                TraceContext& context);
 
     void set_epsilon(double epsilon);
 
     std::vector<std::shared_ptr<Object>> objects = {};
     std::vector<std::shared_ptr<Light>> lights = {};
+    BVH bvh;
+    //Compiled from objects by build_acceleration, objects stays the list used to author the scene
+    PrimitiveGroups bounded_primitives; //Indexed by the primitives of the BVH
+    PrimitiveGroups unbounded_primitives;
+    bool acceleration_built = false;
+    double built_surface_area = 0; //Of the BVH right after its last build
+    double max_refit_growth = 2.0; //A refit that makes the BVH nodes this much larger than when built is a rebuild
     Camera camera;
     unsigned int max_bounces;
     double epsilon = 0.0001; //We discard intersecting object with a t inferior to epsilon
@@ -57,6 +142,14 @@ public:
     int msaa_samples = 1;
     int width = 500;
     int height = 500;
+    unsigned int threads = 1; //0 uses every hardware thread
+    int tile_size = 32;
+    bool packet_tracing = true; //Primary rays are traced by packets of packet_size
+    unsigned int seed = 0;
+    ShadowStatistics shadow_statistics; //Accumulated over every render
 
+private:
+    //Both raycasting, sink can be null
+    Image render(ImageSink* sink);
 };
 
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cmath>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+//Four doubles processed together, backed by an AVX register when the compiler targets AVX (RAYTRACING_NATIVE)
+//and by a plain array the compiler can still vectorize otherwise
+//Comparisons give a Mask4 that selects lanes, like the compare and blend instructions
+#if defined(__AVX__)
+
+struct Mask4
+{
+  __m256d value;
+};
+
+struct Double4
+{
+  Double4() : value(_mm256_setzero_pd()) {}
+  Double4(__m256d value) : value(value) {}
+  explicit Double4(double broadcast) : value(_mm256_set1_pd(broadcast)) {}
+  Double4(double a, double b, double c, double d) : value(_mm256_setr_pd(a, b, c, d)) {}
+
+  static Double4 load(const double* values) { return _mm256_loadu_pd(values); }
+  void store(double* values) const { _mm256_storeu_pd(values, value); }
+
+  double operator[](int lane) const {
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, value);
+    return lanes[lane];
+  }
+
+  __m256d value;
+};
+
+inline Double4 operator+(Double4 a, Double4 b) { return _mm256_add_pd(a.value, b.value); }
+inline Double4 operator-(Double4 a, Double4 b) { return _mm256_sub_pd(a.value, b.value); }
+inline Double4 operator*(Double4 a, Double4 b) { return _mm256_mul_pd(a.value, b.value); }
+inline Double4 operator/(Double4 a, Double4 b) { return _mm256_div_pd(a.value, b.value); }
+inline Double4 operator-(Double4 a) { return _mm256_sub_pd(_mm256_setzero_pd(), a.value); }
+inline Double4 min(Double4 a, Double4 b) { return _mm256_min_pd(a.value, b.value); }
+inline Double4 max(Double4 a, Double4 b) { return _mm256_max_pd(a.value, b.value); }
+inline Double4 sqrt(Double4 a) { return _mm256_sqrt_pd(a.value); }
+inline Double4 abs(Double4 a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.value); }
+inline Double4 floor(Double4 a) { return _mm256_floor_pd(a.value); }
+
+inline Mask4 operator<(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.value, b.value, _CMP_LT_OQ)}; }
+inline Mask4 operator<=(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.value, b.value, _CMP_LE_OQ)}; }
+inline Mask4 operator>(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.value, b.value, _CMP_GT_OQ)}; }
+inline Mask4 operator>=(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.value, b.value, _CMP_GE_OQ)}; }
+inline Mask4 operator!=(Double4 a, Double4 b) { return {_mm256_cmp_pd(a.value, b.value, _CMP_NEQ_OQ)}; }
+inline Mask4 operator&(Mask4 a, Mask4 b) { return {_mm256_and_pd(a.value, b.value)}; }
+inline Mask4 operator|(Mask4 a, Mask4 b) { return {_mm256_or_pd(a.value, b.value)}; }
+
+//Lanes of mask take a, the others b
+inline Double4 select(Mask4 mask, Double4 a, Double4 b) { return _mm256_blendv_pd(b.value, a.value, mask.value); }
+//Bit i is set when lane i is selected
+inline int bits(Mask4 mask) { return _mm256_movemask_pd(mask.value); }
+
+//Eight floats, used where a single ray is tested against several primitives at once
+struct Mask8
+{
+  __m256 value;
+};
+
+struct Float8
+{
+  Float8() : value(_mm256_setzero_ps()) {}
+  Float8(__m256 value) : value(value) {}
+  explicit Float8(float broadcast) : value(_mm256_set1_ps(broadcast)) {}
+
+  static Float8 load(const float* values) { return _mm256_loadu_ps(values); }
+  void store(float* values) const { _mm256_storeu_ps(values, value); }
+
+  __m256 value;
+};
+
+inline Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.value, b.value); }
+inline Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.value, b.value); }
+inline Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.value, b.value); }
+inline Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.value, b.value); }
+inline Float8 abs(Float8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.value); }
+inline Float8 max(Float8 a, Float8 b) { return _mm256_max_ps(a.value, b.value); }
+//The 12 bit estimate of the instruction refined by one Newton step, about 22 correct bits, NaN for 0 and infinity
+inline Float8 reciprocal(Float8 a) {
+  __m256 estimate = _mm256_rcp_ps(a.value);
+  return _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(a.value, estimate)));
+}
+
+inline Mask8 operator<=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_LE_OQ)}; }
+inline Mask8 operator>=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.value, b.value, _CMP_GE_OQ)}; }
+inline Mask8 operator&(Mask8 a, Mask8 b) { return {_mm256_and_ps(a.value, b.value)}; }
+inline int bits(Mask8 mask) { return _mm256_movemask_ps(mask.value); }
+
+#else
+
+struct Mask4
+{
+  bool value[4];
+};
+
+struct Double4
+{
+  Double4() : value{0, 0, 0, 0} {}
+  explicit Double4(double broadcast) : value{broadcast, broadcast, broadcast, broadcast} {}
+  Double4(double a, double b, double c, double d) : value{a, b, c, d} {}
+
+  static Double4 load(const double* values) { return Double4(values[0], values[1], values[2], values[3]); }
+  void store(double* values) const {
+    for (int i = 0; i < 4; ++i) {
+      values[i] = value[i];
+    }
+  }
+
+  double operator[](int lane) const { return value[lane]; }
+
+  double value[4];
+};
+
+template <typename Operation>
+inline Double4 lane_wise(Double4 a, Double4 b, Operation operation) {
+  return Double4(operation(a.value[0], b.value[0]), operation(a.value[1], b.value[1])
+                 , operation(a.value[2], b.value[2]), operation(a.value[3], b.value[3]));
+}
+
+template <typename Comparison>
+inline Mask4 compare(Double4 a, Double4 b, Comparison comparison) {
+  return {{comparison(a.value[0], b.value[0]), comparison(a.value[1], b.value[1])
+           , comparison(a.value[2], b.value[2]), comparison(a.value[3], b.value[3])}};
+}
+
+inline Double4 operator+(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x + y; }); }
+inline Double4 operator-(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x - y; }); }
+inline Double4 operator*(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x * y; }); }
+inline Double4 operator/(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x / y; }); }
+inline Double4 operator-(Double4 a) { return Double4() - a; }
+//Same NaN behaviour as minpd and maxpd, the second operand is returned when the comparison fails
+inline Double4 min(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x < y ? x : y; }); }
+inline Double4 max(Double4 a, Double4 b) { return lane_wise(a, b, [](double x, double y) { return x > y ? x : y; }); }
+inline Double4 sqrt(Double4 a) { return lane_wise(a, a, [](double x, double) { return std::sqrt(x); }); }
+inline Double4 abs(Double4 a) { return lane_wise(a, a, [](double x, double) { return std::fabs(x); }); }
+inline Double4 floor(Double4 a) { return lane_wise(a, a, [](double x, double) { return std::floor(x); }); }
+
+inline Mask4 operator<(Double4 a, Double4 b) { return compare(a, b, [](double x, double y) { return x < y; }); }
+inline Mask4 operator<=(Double4 a, Double4 b) { return compare(a, b, [](double x, double y) { return x <= y; }); }
+inline Mask4 operator>(Double4 a, Double4 b) { return compare(a, b, [](double x, double y) { return x > y; }); }
+inline Mask4 operator>=(Double4 a, Double4 b) { return compare(a, b, [](double x, double y) { return x >= y; }); }
+inline Mask4 operator!=(Double4 a, Double4 b) { return compare(a, b, [](double x, double y) { return x != y; }); }
+inline Mask4 operator&(Mask4 a, Mask4 b) {
+  return {{a.value[0] && b.value[0], a.value[1] && b.value[1], a.value[2] && b.value[2], a.value[3] && b.value[3]}};
+}
+inline Mask4 operator|(Mask4 a, Mask4 b) {
+  return {{a.value[0] || b.value[0], a.value[1] || b.value[1], a.value[2] || b.value[2], a.value[3] || b.value[3]}};
+}
+
+inline Double4 select(Mask4 mask, Double4 a, Double4 b) {
+  return Double4(mask.value[0] ? a.value[0] : b.value[0], mask.value[1] ? a.value[1] : b.value[1]
+                 , mask.value[2] ? a.value[2] : b.value[2], mask.value[3] ? a.value[3] : b.value[3]);
+}
+inline int bits(Mask4 mask) {
+  return mask.value[0] | (mask.value[1] << 1) | (mask.value[2] << 2) | (mask.value[3] << 3);
+}
+
+struct Mask8
+{
+  bool value[8];
+};
+
+struct Float8
+{
+  Float8() : value{} {}
+  explicit Float8(float broadcast) {
+    for (float& lane : value) {
+      lane = broadcast;
+    }
+  }
+
+  static Float8 load(const float* values) {
+    Float8 result;
+    for (int i = 0; i < 8; ++i) {
+      result.value[i] = values[i];
+    }
+    return result;
+  }
+  void store(float* values) const {
+    for (int i = 0; i < 8; ++i) {
+      values[i] = value[i];
+    }
+  }
+
+  float value[8];
+};
+
+template <typename Operation>
+inline Float8 lane_wise(Float8 a, Float8 b, Operation operation) {
+  Float8 result;
+  for (int i = 0; i < 8; ++i) {
+    result.value[i] = operation(a.value[i], b.value[i]);
+  }
+  return result;
+}
+
+template <typename Comparison>
+inline Mask8 compare(Float8 a, Float8 b, Comparison comparison) {
+  Mask8 result;
+  for (int i = 0; i < 8; ++i) {
+    result.value[i] = comparison(a.value[i], b.value[i]);
+  }
+  return result;
+}
+
+inline Float8 operator+(Float8 a, Float8 b) { return lane_wise(a, b, [](float x, float y) { return x + y; }); }
+inline Float8 operator-(Float8 a, Float8 b) { return lane_wise(a, b, [](float x, float y) { return x - y; }); }
+inline Float8 operator*(Float8 a, Float8 b) { return lane_wise(a, b, [](float x, float y) { return x * y; }); }
+inline Float8 operator/(Float8 a, Float8 b) { return lane_wise(a, b, [](float x, float y) { return x / y; }); }
+inline Float8 abs(Float8 a) { return lane_wise(a, a, [](float x, float) { return std::fabs(x); }); }
+inline Float8 max(Float8 a, Float8 b) { return lane_wise(a, b, [](float x, float y) { return x > y ? x : y; }); }
+inline Float8 reciprocal(Float8 a) { return lane_wise(a, a, [](float x, float) { return 1.0f / x; }); }
+
+inline Mask8 operator<=(Float8 a, Float8 b) { return compare(a, b, [](float x, float y) { return x <= y; }); }
+inline Mask8 operator>=(Float8 a, Float8 b) { return compare(a, b, [](float x, float y) { return x >= y; }); }
+inline Mask8 operator&(Mask8 a, Mask8 b) {
+  Mask8 result;
+  for (int i = 0; i < 8; ++i) {
+    result.value[i] = a.value[i] && b.value[i];
+  }
+  return result;
+}
+inline int bits(Mask8 mask) {
+  int result = 0;
+  for (int i = 0; i < 8; ++i) {
+    result |= mask.value[i] << i;
+  }
+  return result;
+}
+
+#endif
+
+inline bool any(Mask4 mask) { return bits(mask) != 0; }
+
+//Three component vector of packets, one lane per ray
+struct Vector3x4
+{
+  Double4 x;
+  Double4 y;
+  Double4 z;
+};
+
+inline Vector3x4 operator-(const Vector3x4& a, const Vector3x4& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Double4 dot(const Vector3x4& a, const Vector3x4& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vector3x4 cross(const Vector3x4& a, const Vector3x4& b) {
+  return {a.y * b.z - b.y * a.z, b.x * a.z - a.x * b.z, a.x * b.y - b.x * a.y};
+}
+
+//Same for eight lanes of floats
+struct Vector3x8
+{
+  Float8 x;
+  Float8 y;
+  Float8 z;
+};
+
+inline Vector3x8 operator-(const Vector3x8& a, const Vector3x8& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Float8 dot(const Vector3x8& a, const Vector3x8& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vector3x8 cross(const Vector3x8& a, const Vector3x8& b) {
+  return {a.y * b.z - b.y * a.z, b.x * a.z - a.x * b.z, a.x * b.y - b.x * a.y};
+}
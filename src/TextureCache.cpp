@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "TextureCache.hh"
+
+CachedTexture::CachedTexture(TextureCache& cache, std::string filename)
+    : filename(std::move(filename))
+    , cache(cache)
+    , slot(std::make_unique<Slot>())
+{}
+
+const MipTexture& CachedTexture::texture() {
+  if (!slot->resident.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(slot->decoding);
+    if (!slot->resident.load(std::memory_order_relaxed)) {
+      slot->texture = MipTexture(Image(filename));
+      cache.resident_bytes += slot->texture.memory_bytes();
+      ++cache.decodes;
+      slot->resident.store(true, std::memory_order_release);
+    }
+  }
+  //Written only once per generation so the threads do not keep taking the cache line from each other
+  std::uint64_t generation = cache.generation.load(std::memory_order_relaxed);
+  if (last_use.load(std::memory_order_relaxed) != generation) {
+    last_use.store(generation, std::memory_order_relaxed);
+  }
+  return slot->texture;
+}
+
+std::ostream& operator<<(std::ostream& out, const TextureCacheStatistics& statistics) {
+  return out << "Textures : " << statistics.textures << " Resident : " << statistics.resident << " ("
+             << statistics.resident_bytes / (1024.0 * 1024.0) << " MiB) Decodes : " << statistics.decodes
+             << " Evictions : " << statistics.evictions << '\n';
+}
+
+TextureCache& TextureCache::instance() {
+  static TextureCache cache;
+  return cache;
+}
+
+std::shared_ptr<CachedTexture> TextureCache::get(const std::string& filename) {
+  std::string key = std::filesystem::path(filename).lexically_normal().string();
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = textures.find(key);
+  if (found != textures.end()) {
+    return found->second;
+  }
+  //A missing file is still reported when the scene is built
+  if (!std::ifstream(key).is_open()) {
+    throw std::invalid_argument("Could not open file " + filename);
+  }
+  auto texture = std::make_shared<CachedTexture>(*this, key);
+  textures.emplace(key, texture);
+  return texture;
+}
+
+void TextureCache::evict(CachedTexture& texture) {
+  if (!texture.slot->resident) {
+    return;
+  }
+  resident_bytes -= texture.slot->texture.memory_bytes();
+  texture.slot = std::make_unique<CachedTexture::Slot>();
+  ++evictions;
+}
+
+TextureCache::RenderGuard::RenderGuard(TextureCache& cache)
+    : cache(cache)
+{
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.trim_locked();
+  ++cache.renders;
+}
+
+TextureCache::RenderGuard::~RenderGuard() {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  --cache.renders;
+}
+
+std::size_t TextureCache::trim() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return trim_locked();
+}
+
+std::size_t TextureCache::trim_locked() {
+  //The other threads may be holding references to the decoded textures
+  if (renders > 0) {
+    return 0;
+  }
+  std::uint64_t evicted = evictions;
+  for (auto it = textures.begin(); it != textures.end();) {
+    if (it->second.use_count() == 1) {
+      evict(*it->second);
+      it = textures.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  if (budget > 0 && resident_bytes > budget) {
+    std::vector<CachedTexture*> resident;
+    for (auto& [key, texture] : textures) {
+      if (texture->slot->resident) {
+        resident.push_back(texture.get());
+      }
+    }
+    //Among the textures of a same generation the largest go first, fewer of them have to be decoded again
+    std::sort(resident.begin(), resident.end(), [](const CachedTexture* a, const CachedTexture* b) {
+      std::uint64_t a_use = a->last_use.load(std::memory_order_relaxed);
+      std::uint64_t b_use = b->last_use.load(std::memory_order_relaxed);
+      if (a_use != b_use) {
+        return a_use < b_use;
+      }
+      return a->slot->texture.memory_bytes() > b->slot->texture.memory_bytes();
+    });
+    for (std::size_t i = 0; i < resident.size() && resident_bytes > budget; ++i) {
+      evict(*resident[i]);
+    }
+  }
+  ++generation;
+  return evictions - evicted;
+}
+
+TextureCacheStatistics TextureCache::statistics() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  TextureCacheStatistics statistics;
+  statistics.textures = textures.size();
+  for (auto& [key, texture] : textures) {
+    statistics.resident += texture->slot->resident;
+  }
+  statistics.resident_bytes = resident_bytes;
+  statistics.decodes = decodes;
+  statistics.evictions = evictions;
+  return statistics;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include "MipTexture.hh"
+
+class TextureCache;
+
+//A texture file of the cache, decoded the first time it is looked up
+class CachedTexture
+{
+public:
+  CachedTexture(TextureCache& cache, std::string filename);
+
+  //Decodes the file on the first call while the other threads wait for it, throws std::invalid_argument if it is
+  //malformed and the next call tries again
+  //From a render the exception goes through ThreadPool::parallel_for up to the caller of Scene::raycasting
+  const MipTexture& texture();
+
+  const std::string filename;
+
+private:
+  friend class TextureCache;
+
+  //Replaced by an empty one when the texture is evicted so that it can be decoded again
+  //Not a std::once_flag, with libstdc++ a call_once whose function throws can leave the other threads waiting forever
+  struct Slot
+  {
+    std::mutex decoding;
+    MipTexture texture;
+    std::atomic<bool> resident{false}; //Set once texture is decoded
+  };
+
+  TextureCache& cache;
+  std::unique_ptr<Slot> slot;
+  std::atomic<std::uint64_t> last_use{0}; //Generation of the cache when it was last looked up
+};
+
+struct TextureCacheStatistics
+{
+  std::size_t textures = 0;
+  std::size_t resident = 0;
+  std::size_t resident_bytes = 0;
+  std::uint64_t decodes = 0;
+  std::uint64_t evictions = 0;
+  std::size_t renders = 0; //In flight, under mutex
+};
+
+std::ostream& operator<<(std::ostream& out, const TextureCacheStatistics& statistics);
+
+//Textures of the whole process keyed by the normalized path of their file, the textures made from the same file share
+//one entry and one decoded copy
+//With a budget, trim evicts the textures looked up the least recently until the resident ones fit in it
+//The lookups do not lock, so nothing is evicted while a render is in flight, a frame keeps the textures it needs
+class TextureCache
+{
+public:
+  //Held by a render for as long as it looks textures up, trims the cache first if no other render is in flight
+  class RenderGuard
+  {
+  public:
+    explicit RenderGuard(TextureCache& cache);
+    ~RenderGuard();
+
+    RenderGuard(const RenderGuard&) = delete;
+    RenderGuard& operator=(const RenderGuard&) = delete;
+
+  private:
+    TextureCache& cache;
+  };
+
+  static TextureCache& instance();
+
+  //Throws std::invalid_argument if the file cannot be opened, it is only decoded on its first lookup
+  std::shared_ptr<CachedTexture> get(const std::string& filename);
+
+  //Drops the textures no one uses anymore and evicts down to the budget, returns the number of textures evicted
+  //Does nothing while a render is in flight
+  std::size_t trim();
+
+  [[nodiscard]] TextureCacheStatistics statistics() const;
+
+  std::size_t budget = 0; //In bytes of resident textures, 0 for no limit
+
+private:
+  friend class CachedTexture;
+
+  TextureCache() = default;
+
+  void evict(CachedTexture& texture);
+
+  //Same as trim with mutex held
+  std::size_t trim_locked();
+
+  mutable std::mutex mutex; //Of textures and the eviction, the lookups never take it
+  std::unordered_map<std::string, std::shared_ptr<CachedTexture>> textures;
+  std::atomic<std::uint64_t> generation{1}; //Moves on at each trim
+  std::atomic<std::size_t> resident_bytes{0};
+  std::atomic<std::uint64_t> decodes{0};
+  std::uint64_t evictions = 0;
+  std::size_t renders = 0; //In flight, under mutex
+};
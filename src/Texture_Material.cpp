@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <utility>
 #include <iostream>
 
@@ -26,26 +27,51 @@ Texture_Material::Texture_Material(Caracteristics caracteristics)
 Uniform_Texture::Uniform_Texture(Caracteristics caracteristics)
     : Texture_Material{std::move(caracteristics)} {}
 
-Procedural_Texture::Procedural_Texture(Caracteristics caracteristics)
-    : Texture_Material(std::move(caracteristics)) {}
+Procedural_Texture::Procedural_Texture(Caracteristics caracteristics, Pixel secondary_pixel, double frequency,
+                                       NoiseBasis basis, Fractal fractal, std::uint32_t seed)
+    : Texture_Material(std::move(caracteristics))
+    , secondary_pixel(secondary_pixel)
+    , frequency(frequency)
+    , basis(basis)
+    , fractal(fractal)
+    , noise(seed) {}
 
 Image_Texture::Image_Texture(Caracteristics caracteristics, const std::string& filename)
     : Texture_Material(std::move(caracteristics))
-    , image(Image(filename)) {}
+    , image(TextureCache::instance().get(filename)) {}
 
 Caracteristics Uniform_Texture::caracteristics_point(const Point3&) {
   return caracteristics;
 }
 
-Caracteristics Procedural_Texture::caracteristics_point(const Point3 &point) {
+Caracteristics Texture_Material::caracteristics_solid(const Point3&) {
   return caracteristics;
 }
 
+Caracteristics Texture_Material::caracteristics_filtered(const Point3& point, double) {
+  return caracteristics_point(point);
+}
+
+Caracteristics Procedural_Texture::caracteristics_point(const Point3 &point) {
+  double value = noise.fbm(basis, point.x * frequency, point.y * frequency, point.z * frequency, fractal);
+  double blend = std::clamp(0.5 + 0.5 * value, 0.0, 1.0);
+  Caracteristics res = caracteristics;
+  res.pixel = caracteristics.pixel * (1 - blend) + secondary_pixel * blend;
+  return res;
+}
+
+Caracteristics Procedural_Texture::caracteristics_solid(const Point3 &point) {
+  return caracteristics_point(point);
+}
+
 Caracteristics Image_Texture::caracteristics_point(const Point3 &point) {
-  int x = point.x * image.width;
-  int y = point.y * image.height;
-  Pixel value = image.pixels[x + y * image.width];
   Caracteristics res = caracteristics;
-  res.pixel = value;
+  res.pixel = image->texture().sample(point.x, point.y);
+  return res;
+}
+
+Caracteristics Image_Texture::caracteristics_filtered(const Point3 &point, double footprint) {
+  Caracteristics res = caracteristics;
+  res.pixel = image->texture().sample(point.x, point.y, footprint);
   return res;
 }
\ No newline at end of file
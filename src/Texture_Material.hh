@@ -1,6 +1,8 @@
 #pragma once
 #include "Vector3.hh"
 #include "Image.hh"
+#include "TextureCache.hh"
+#include "Noise.hh"
 #include <optional>
 
 struct Caracteristics {
@@ -17,6 +19,11 @@ class Texture_Material {
  public:
   explicit Texture_Material(Caracteristics caracteristics);
   virtual Caracteristics caracteristics_point(const Point3& point) = 0;
+  //footprint is the width in texture coordinates the point stands for, only the image textures filter over it
+  virtual Caracteristics caracteristics_filtered(const Point3& point, double footprint);
+  //For the objects without texture coordinates, point is the position in space
+  //Only the textures defined over the whole space use it, the others keep their base caracteristics
+  virtual Caracteristics caracteristics_solid(const Point3& point);
 
   Caracteristics caracteristics;
 };
@@ -27,19 +34,31 @@ class Uniform_Texture : public Texture_Material {
   Caracteristics caracteristics_point(const Point3& point) override;
 };
 
+//Blend between the base pixel and secondary_pixel driven by fractal noise, the point is scaled by frequency
+//caracteristics_point takes the point in space so the texture works with or without texture coordinates
 class Procedural_Texture : public Texture_Material {
  public:
-  explicit Procedural_Texture(Caracteristics caracteristics);
+  Procedural_Texture(Caracteristics caracteristics, Pixel secondary_pixel, double frequency,
+                     NoiseBasis basis = NoiseBasis::simplex, Fractal fractal = Fractal(), std::uint32_t seed = 0);
   Caracteristics caracteristics_point(const Point3& point) override;
+  Caracteristics caracteristics_solid(const Point3& point) override;
+
+  Pixel secondary_pixel;
+  double frequency;
+  NoiseBasis basis;
+  Fractal fractal;
+  GradientNoise noise;
 };
 
+//The image comes from TextureCache, the textures made from the same file share it and it is decoded on the first lookup
 class Image_Texture : public Texture_Material {
  public:
   explicit Image_Texture(Caracteristics caracteristics, const std::string& filename);
   //I think the point ought to have 2 dimension and be the u and v coordinates
   //u and v between 0 and 1
   Caracteristics caracteristics_point(const Point3& point) override;
+  Caracteristics caracteristics_filtered(const Point3& point, double footprint) override;
 
-  Image image;
+  std::shared_ptr<CachedTexture> image;
 };
 
@@ -0,0 +1,116 @@
+#include "ThreadPool.hh"
+#include <algorithm>
+#include <utility>
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+  if (thread_count == 0) {
+    thread_count = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+  //Worker 0 is the thread calling parallel_for
+  for (unsigned int i = 1; i < thread_count; ++i) {
+    threads.emplace_back(&ThreadPool::worker_loop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start_condition.notify_all();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+unsigned int ThreadPool::size() const {
+  return queues.size();
+}
+
+void ThreadPool::parallel_for(std::size_t task_count, const std::function<void(std::size_t, unsigned int)>& task) {
+  //Contiguous chunks so that each worker starts on neighbouring tiles
+  for (std::size_t i = 0; i < task_count; ++i) {
+    queues[i * queues.size() / task_count]->tasks.push_back(i);
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current_task = &task;
+    finished_workers = 0;
+    error = nullptr;
+    failed = false;
+    ++generation;
+  }
+  start_condition.notify_all();
+  run_tasks(0);
+  //Every worker has to be done with this generation before task goes out of scope
+  std::unique_lock<std::mutex> lock(mutex);
+  done_condition.wait(lock, [&] { return finished_workers == threads.size(); });
+  current_task = nullptr;
+  if (error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+}
+
+void ThreadPool::worker_loop(unsigned int worker) {
+  std::size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_condition.wait(lock, [&] { return stopping || generation != seen_generation; });
+      if (stopping) {
+        return;
+      }
+      seen_generation = generation;
+    }
+    run_tasks(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++finished_workers;
+    }
+    done_condition.notify_one();
+  }
+}
+
+void ThreadPool::run_tasks(unsigned int worker) {
+  std::size_t task;
+  while (pop_task(worker, task)) {
+    //After a failure the remaining tasks are only taken off the queues
+    if (failed.load(std::memory_order_relaxed)) {
+      continue;
+    }
+    try {
+      (*current_task)(task, worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      failed = true;
+    }
+  }
+}
+
+bool ThreadPool::pop_task(unsigned int worker, std::size_t& task) {
+  {
+    WorkQueue& own = *queues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+    WorkQueue& victim = *queues[(worker + offset) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed set of workers, each one owns a queue of task indices and steals from the back of the others once its own
+//queue is empty, so that expensive tiles do not leave the other cores idle at the end of a render
+class ThreadPool
+{
+public:
+  //0 means one worker per hardware thread
+  explicit ThreadPool(unsigned int thread_count = 0);
+  ~ThreadPool();
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  //Calls task(index, worker) for every index in [0, task_count) and returns once they are all done
+  //The calling thread takes part in the work as worker 0, worker is always inferior to size()
+  //If a task throws, the tasks not started yet are skipped and the first exception is rethrown once all workers are done
+  void parallel_for(std::size_t task_count, const std::function<void(std::size_t, unsigned int)>& task);
+
+  [[nodiscard]] unsigned int size() const;
+
+private:
+  struct WorkQueue
+  {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  void worker_loop(unsigned int worker);
+  void run_tasks(unsigned int worker);
+  bool pop_task(unsigned int worker, std::size_t& task);
+
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  std::mutex mutex;
+  std::condition_variable start_condition;
+  std::condition_variable done_condition;
+  const std::function<void(std::size_t, unsigned int)>* current_task = nullptr;
+  std::size_t generation = 0;
+  unsigned int finished_workers = 0;
+  bool stopping = false;
+  std::exception_ptr error; //First one thrown by a task of the current generation
+  std::atomic<bool> failed{false};
+};
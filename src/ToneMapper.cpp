@@ -0,0 +1,108 @@
+#include <cmath>
+#include <cstring>
+
+#include "ToneMapper.hh"
+#include "Image.hh"
+#include "Simd.hh"
+
+static std::uint64_t bits_of(double value) {
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+static double double_of(std::uint64_t bits) {
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+ToneMapper::ToneMapper(double gamma)
+    : white(std::pow(255.0, gamma))
+    , gamma_value(gamma)
+{
+  //The positive doubles are ordered like their bits, compress_value is monotonic on them
+  thresholds[0] = 0;
+  for (int level = 1; level < 256; ++level) {
+    std::uint64_t low = 0;
+    std::uint64_t high = bits_of(INFINITY);
+    while (low < high) {
+      std::uint64_t middle = low + (high - low) / 2;
+      if (Image::compress_value(double_of(middle), gamma) >= level) {
+        high = middle;
+      } else {
+        low = middle + 1;
+      }
+    }
+    thresholds[level] = double_of(low);
+  }
+
+  //As many mantissa bits as needed for two consecutive thresholds to never share a bucket
+  for (int mantissa_bits = 7;; ++mantissa_bits) {
+    shift = 52 - mantissa_bits;
+    bool separated = true;
+    for (int level = 1; level < 255 && separated; ++level) {
+      separated = (bits_of(thresholds[level + 1]) >> shift) > (bits_of(thresholds[level]) >> shift);
+    }
+    if (separated || mantissa_bits == 52) {
+      break;
+    }
+  }
+  first_bucket = bits_of(thresholds[1]) >> shift;
+  std::uint64_t last_bucket = bits_of(thresholds[255]) >> shift;
+  bucket_levels.resize(last_bucket - first_bucket + 1);
+  int level = 0;
+  for (std::uint64_t bucket = first_bucket; bucket <= last_bucket; ++bucket) {
+    double start = double_of(bucket << shift);
+    while (level < 255 && thresholds[level + 1] <= start) {
+      ++level;
+    }
+    bucket_levels[bucket - first_bucket] = level;
+  }
+}
+
+double ToneMapper::gamma() const {
+  return gamma_value;
+}
+
+unsigned char ToneMapper::quantize(double value) const {
+  if (!(value >= 0)) {
+    return Image::compress_value(value, gamma_value); //NaN and negative values, as rare as they are odd
+  }
+  if (value < thresholds[1]) {
+    return 0;
+  }
+  if (value >= thresholds[255]) {
+    return 255;
+  }
+  unsigned char level = bucket_levels[(bits_of(value) >> shift) - first_bucket];
+  return level + (value >= thresholds[level + 1]);
+}
+
+unsigned char ToneMapper::map(double value) const {
+  value *= exposure;
+  if (curve == ToneCurve::reinhard) {
+    value = value / (1.0 + value / white);
+  }
+  return quantize(value);
+}
+
+void ToneMapper::map(const float* values, unsigned char* output, std::size_t count) const {
+  Float8 scale(static_cast<float>(exposure));
+  Float8 inv_white(static_cast<float>(1.0 / white));
+  Float8 one(1.0f);
+  for (std::size_t i = 0; i < count; i += 8) {
+    //The last values are padded to a whole packet
+    std::size_t lanes = std::min<std::size_t>(8, count - i);
+    float packet[8] = {};
+    std::memcpy(packet, values + i, lanes * sizeof(float));
+    Float8 value = Float8::load(packet) * scale;
+    if (curve == ToneCurve::reinhard) {
+      value = value / (one + value * inv_white);
+    }
+    value.store(packet);
+    for (std::size_t lane = 0; lane < lanes; ++lane) {
+      output[i + lane] = quantize(packet[lane]);
+    }
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//clamp keeps the linear value and saturates like Image::compress_value
+//reinhard compresses it as value / (1 + value / white), so the highlights approach white instead of clipping
+enum class ToneCurve
+{
+  clamp,
+  reinhard
+};
+
+//Turns linear colors into 8 bit gamma corrected channels, for the clamp curve without exposure the output is exactly
+//Image::compress_value
+//The gamma is a table of the 255 values where the output changes, found by bisection on compress_value itself, and
+//indexed by the exponent and the first mantissa bits of the value so that a lookup replaces the pow per channel
+class ToneMapper
+{
+public:
+  explicit ToneMapper(double gamma = 2.2);
+
+  [[nodiscard]] unsigned char map(double value) const;
+
+  //Eight values at a time through the curve in floats, then through the table
+  void map(const float* values, unsigned char* output, std::size_t count) const;
+
+  [[nodiscard]] double gamma() const;
+
+  ToneCurve curve = ToneCurve::clamp;
+  double exposure = 1.0; //Applied before the curve
+  double white; //Value reinhard tends to, the one where compress_value saturates by default
+
+private:
+  //Gamma correction of a value already through the curve
+  [[nodiscard]] unsigned char quantize(double value) const;
+
+  double gamma_value;
+  double thresholds[256]; //thresholds[k] is the smallest value whose output is k, for k >= 1
+  int shift; //Of the bits of a double, what is left indexes bucket_levels
+  std::uint64_t first_bucket;
+  std::vector<unsigned char> bucket_levels; //Output at the start of each bucket, at most one threshold inside
+};
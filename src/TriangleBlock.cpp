@@ -0,0 +1,55 @@
+#include <algorithm>
+
+#include "TriangleBlock.hh"
+
+void TriangleBlock::set(int lane, const Point3& A, const Point3& B, const Point3& C, std::uint32_t triangle) {
+  Vector3 AB(A, B);
+  Vector3 AC(A, C);
+  Vector3 normal = AB.vector_product(AC);
+  for (int axis = 0; axis < 3; ++axis) {
+    this->A[axis][lane] = A[axis];
+    this->AB[axis][lane] = AB[axis];
+    this->AC[axis][lane] = AC[axis];
+    this->normal[axis][lane] = normal[axis];
+  }
+  edge[lane] = std::max(AB.norm(), AC.norm());
+  norm_A[lane] = A.norm();
+  norm_normal[lane] = normal.norm();
+  triangles[lane] = triangle;
+  if (lane >= count) {
+    count = lane + 1;
+  }
+}
+
+//Moller Trumbore rewritten with the precomputed normal N = AB x AC and K = AO x D, one cross product per lane
+// determinant = -D . N
+// u = (AC . K) / determinant
+// v = -(AB . K) / determinant
+// t = (AO . N) / determinant
+int TriangleBlock::candidates(const Rayon& ray, double t_min, double t_max) const {
+  auto load = [](const float (&components)[3][triangle_block_size]) {
+    return Vector3x8{Float8::load(components[0]), Float8::load(components[1]), Float8::load(components[2])};
+  };
+  Vector3x8 D{Float8(ray.direction.x), Float8(ray.direction.y), Float8(ray.direction.z)};
+  Vector3x8 O{Float8(ray.origin.x), Float8(ray.origin.y), Float8(ray.origin.z)};
+  Vector3x8 N = load(normal);
+  Vector3x8 AO = O - load(A);
+  Vector3x8 K = cross(AO, D);
+
+  //Degenerate lanes give a null determinant, their u, v and t are NaN or infinite and fail the comparisons
+  Float8 inv_determinant = Float8(-1.0f) / dot(D, N);
+  Float8 u = dot(load(AC), K) * inv_determinant;
+  Float8 v = Float8(0.0f) - dot(load(AB), K) * inv_determinant;
+  Float8 t = dot(AO, N) * inv_determinant;
+
+  //AO is rounded from coordinates as large as |O| + |A|, and its error goes through K to u and v over |determinant|
+  //The determinant itself is off by about |N| times an epsilon
+  Float8 reach = Float8(static_cast<float>(ray.origin.norm())) + Float8::load(norm_A);
+  Float8 inv_magnitude = Float8(rounding) * abs(inv_determinant);
+  Float8 uv_margin = Float8(tolerance) + (Float8::load(edge) * reach + Float8::load(norm_normal)) * inv_magnitude;
+  Float8 margin = Float8(tolerance) * (Float8(1.0f) + abs(t)) + reach * Float8::load(norm_normal) * inv_magnitude;
+  Float8 zero(0.0f);
+  Mask8 inside = (u >= zero - uv_margin) & (v >= zero - uv_margin) & (u + v <= Float8(1.0f) + uv_margin);
+  Mask8 in_range = (t >= Float8(t_min) - margin) & (t <= Float8(t_max) + margin);
+  return bits(inside & in_range) & ((1 << count) - 1);
+}
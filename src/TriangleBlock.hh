@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include "Rayon.hh"
+#include "Simd.hh"
+
+constexpr int triangle_block_size = 8;
+
+//Up to triangle_block_size triangles stored component by component in float lanes, so that a ray is tested
+//against all of them by one SIMD Moller Trumbore
+//The float test only selects candidates, they are confirmed in double precision by intersect_triangle
+//Its margins grow with the distance of the triangle and of the ray origin from the world origin over the size of the
+//triangle, the rounding errors of float do, so that a hit found in double is never rejected
+struct TriangleBlock
+{
+  void set(int lane, const Point3& A, const Point3& B, const Point3& C, std::uint32_t triangle);
+
+  //Bit i is set when the ray may hit the triangle of lane i with t_min < t < t_max
+  [[nodiscard]] int candidates(const Rayon& ray, double t_min, double t_max) const;
+
+  //Indexed by axis then lane, the unused lanes stay degenerate and are never candidates
+  alignas(32) float A[3][triangle_block_size] = {};
+  alignas(32) float AB[3][triangle_block_size] = {};
+  alignas(32) float AC[3][triangle_block_size] = {};
+  alignas(32) float normal[3][triangle_block_size] = {}; //AB x AC, not normalized
+  //Lengths the rounding errors of a lane are proportional to
+  alignas(32) float edge[triangle_block_size] = {}; //Longest of AB and AC
+  alignas(32) float norm_A[triangle_block_size] = {};
+  alignas(32) float norm_normal[triangle_block_size] = {};
+  std::uint32_t triangles[triangle_block_size] = {};
+  int count = 0;
+
+  //Margin on u, v and t besides the rounding bound
+  static constexpr float tolerance = 1e-3f;
+  //Some float epsilons for each of the rounded operations a coordinate goes through
+  static constexpr float rounding = 16 * 1.2e-7f;
+};
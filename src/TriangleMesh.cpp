@@ -1,50 +1,190 @@
+#include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "TriangleMesh.hh"
 
-
-void triangleMesh(Scene& scene, std::shared_ptr<Texture_Material> texture_material, const std::vector<int> &faceIndex
-                           , const std::vector<int> &vertexIndices, std::vector<Point3> points
-                           , const std::vector<Vector3> &normals, const std::vector<Point3>& textureCoordinates)
+TriangleMesh::TriangleMesh(std::shared_ptr<Texture_Material> texture_material, std::vector<Point3> vertices,
+                           std::vector<std::uint32_t> indices, std::vector<Vector3> normals,
+                           std::vector<Point3> texture_coordinates, std::vector<std::uint32_t> attribute_indices)
+    : Object{std::move(texture_material)}
+    , vertices(std::move(vertices))
+    , indices(std::move(indices))
+    , normals(std::move(normals))
+    , texture_coordinates(std::move(texture_coordinates))
+    , attribute_indices(std::move(attribute_indices))
 {
-  //or store a list of created triangle ?
-  for (size_t i = 0, k = 0; i < faceIndex.size(); ++i) {
-    for (int j = 0; j < faceIndex[i] - 2; ++j) {
-      int index_1 = k;
-      int index_2 = k + j + 1;
-      int index_3 = k + j + 2;
-      scene.add_object(std::make_shared<SmoothTriangle>(texture_material
-          , points[vertexIndices[index_1]], points[vertexIndices[index_2]], points[vertexIndices[index_3]]
-          , normals[index_1], normals[index_2], normals[index_3]
-          , textureCoordinates[index_1], textureCoordinates[index_2], textureCoordinates[index_3]));
-      //TODO add texture_coordinates to the triangle
-      //But where to add them ?
+  std::vector<BoundingBox> boxes;
+  boxes.reserve(triangle_count());
+  for (std::size_t i = 0; i < this->indices.size(); i += 3) {
+    boxes.push_back(BoundingBox().expand(this->vertices[this->indices[i]]).expand(this->vertices[this->indices[i + 1]])
+                        .expand(this->vertices[this->indices[i + 2]]).pad(epsilon));
+  }
+  //The leaves of a first BVH over the triangles group them by neighbourhood, they are cut into blocks
+  BVH triangle_bvh;
+  triangle_bvh.max_leaf_size = triangle_block_size;
+  triangle_bvh.build(boxes);
+  std::vector<BoundingBox> block_boxes;
+  for (const BVHNode& node : triangle_bvh.nodes) {
+    if (node.count == 0) {
+      continue;
+    }
+    for (std::uint32_t first = node.first; first < node.first + node.count; first += triangle_block_size) {
+      TriangleBlock block;
+      BoundingBox block_box;
+      for (std::uint32_t i = first; i < std::min(first + triangle_block_size, node.first + node.count); ++i) {
+        std::uint32_t triangle = triangle_bvh.primitives[i];
+        block.set(i - first, this->vertices[this->indices[3 * triangle]],
+                  this->vertices[this->indices[3 * triangle + 1]], this->vertices[this->indices[3 * triangle + 2]],
+                  triangle);
+        block_box.expand(boxes[triangle]);
+      }
+      blocks.push_back(block);
+      block_boxes.push_back(block_box);
     }
-    k += faceIndex[i];
   }
+  bvh.build(block_boxes);
+}
+
+std::size_t TriangleMesh::triangle_count() const {
+  return indices.size() / 3;
+}
+
+std::uint32_t TriangleMesh::attribute_index(std::uint32_t triangle, int corner) const {
+  return attribute_indices.empty() ? indices[3 * triangle + corner] : attribute_indices[3 * triangle + corner];
+}
+
+std::optional<HitRecord> TriangleMesh::is_intersecting(const Rayon& ray) const {
+  return find_nearest(ray, epsilon, std::numeric_limits<double>::infinity());
+}
+
+std::optional<HitRecord> TriangleMesh::intersect_triangle(std::uint32_t triangle, const Rayon& ray, double t_min,
+                                                          double t_max) const {
+  const Point3& A = vertices[indices[3 * triangle]];
+  auto hit = ::intersect_triangle(A, Vector3(A, vertices[indices[3 * triangle + 1]])
+                                  , Vector3(A, vertices[indices[3 * triangle + 2]]), ray, t_min, t_max, epsilon);
+  if (hit) {
+    hit->primitive_id = triangle;
+  }
+  return hit;
+}
+
+std::optional<HitRecord> TriangleMesh::find_nearest(const Rayon& ray, double t_min, double t_max) const {
+  std::optional<HitRecord> closest;
+  bvh.find_nearest(ray, t_max, [&](std::uint32_t block_index, double& t_closest) {
+    const TriangleBlock& block = blocks[block_index];
+    int candidates = block.candidates(ray, t_min, t_closest);
+    bool found = false;
+    for (int lane = 0; candidates != 0; ++lane, candidates >>= 1) {
+      if ((candidates & 1) == 0) {
+        continue;
+      }
+      auto hit = intersect_triangle(block.triangles[lane], ray, t_min, t_closest);
+      if (hit) {
+        t_closest = hit->t;
+        closest = hit;
+        found = true;
+      }
+    }
+    return found;
+  });
+  return closest;
 }
-/*std::optional<double> TriangleMesh::is_intersecting(const Rayon &ray) {
 
-  Rayon ray_translated(ray.direction, ray.origin);
-  //Translation for reflection/refraction
-  ray_translated.origin = ray.origin + ray.direction * epsilon;
-  std::optional<double> t_min;
-  for (auto &triangle : triangles) {
-    auto t = triangle.is_intersecting(ray_translated);
-    if (t) {
-      if (t > this->epsilon && (!t_min || t < t_min.value())) {
-        t_min = t;
+bool TriangleMesh::is_occluding(const Rayon& ray, double t_min, double t_max) const {
+  return bvh.find_any(ray, t_max, [&](std::uint32_t block_index) {
+    const TriangleBlock& block = blocks[block_index];
+    int candidates = block.candidates(ray, t_min, t_max);
+    for (int lane = 0; candidates != 0; ++lane, candidates >>= 1) {
+      if ((candidates & 1) == 0) {
+        continue;
+      }
+      std::uint32_t triangle = block.triangles[lane];
+      const Point3& A = vertices[indices[3 * triangle]];
+      if (occlude_triangle(A, Vector3(A, vertices[indices[3 * triangle + 1]])
+                           , Vector3(A, vertices[indices[3 * triangle + 2]]), ray, t_min, t_max, epsilon)) {
+        return true;
       }
     }
+    return false;
+  });
+}
+
+//The rays of a packet are tested one triangle at a time, the lanes being the rays
+void TriangleMesh::intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const {
+  bvh.find_nearest(packet, closest, [&](std::uint32_t block_index) {
+    const TriangleBlock& block = blocks[block_index];
+    for (int lane = 0; lane < block.count; ++lane) {
+      std::uint32_t triangle = block.triangles[lane];
+      const Point3& A = vertices[indices[3 * triangle]];
+      Double4 t, u, v;
+      Mask4 valid = ::intersect_triangle(A, Vector3(A, vertices[indices[3 * triangle + 1]])
+                                         , Vector3(A, vertices[indices[3 * triangle + 2]]), packet, t_min, closest.t
+                                         , epsilon, t, u, v);
+      closest.record(valid, t, u, v, this, triangle);
+    }
+  });
+}
+
+//Same conventions as SmoothTriangle, u weights the second corner, v the third and w = 1 - u - v the first
+Vector3 TriangleMesh::normal_at_point(const HitRecord& hit, const Point3&, const Rayon& ray) const {
+  Vector3 normal;
+  if (normals.empty()) {
+    const Point3& A = vertices[indices[3 * hit.primitive_id]];
+    normal = Vector3(A, vertices[indices[3 * hit.primitive_id + 1]])
+        .vector_product(Vector3(A, vertices[indices[3 * hit.primitive_id + 2]])).normalize();
+  } else {
+    double w = 1.0 - hit.u - hit.v;
+    normal = w * normals[attribute_index(hit.primitive_id, 0)] + hit.u * normals[attribute_index(hit.primitive_id, 1)]
+             + hit.v * normals[attribute_index(hit.primitive_id, 2)];
+  }
+  if (ray.direction.scalar_product(normal) > 0) {
+    return -1.0 * normal;
+  }
+  return normal;
+}
+
+Caracteristics TriangleMesh::texture_at_point(const HitRecord& hit, const Point3& point) const {
+  if (texture_coordinates.empty()) {
+    return texture_material->caracteristics_solid(point);
   }
-  return t_min;
+  double w = 1.0 - hit.u - hit.v;
+  const Point3& A_text_coord = texture_coordinates[attribute_index(hit.primitive_id, 0)];
+  const Point3& B_text_coord = texture_coordinates[attribute_index(hit.primitive_id, 1)];
+  const Point3& C_text_coord = texture_coordinates[attribute_index(hit.primitive_id, 2)];
+  Point3 coordinate = A_text_coord * w + B_text_coord * hit.u + C_text_coord * hit.v;
+  const Point3& A = vertices[indices[3 * hit.primitive_id]];
+  double footprint = hit.footprint * texture_scale(Vector3(A, vertices[indices[3 * hit.primitive_id + 1]]),
+                                                   Vector3(A, vertices[indices[3 * hit.primitive_id + 2]]),
+                                                   A_text_coord, B_text_coord, C_text_coord);
+  return texture_material->caracteristics_filtered(coordinate, footprint);
 }
 
-Vector3 TriangleMesh::normal_at_point(const Point3 &point, const Rayon &ray) {
-  triangles[0].normal_at_point(point, ray);//TODO don't work
-  return Vector3();
+std::optional<BoundingBox> TriangleMesh::bounding_box() const {
+  if (bvh.is_empty()) {
+    return BoundingBox();
+  }
+  return bvh.nodes[0].box;
 }
-Caracteristics TriangleMesh::texture_at_point(const Point3 &point) {
-  return texture_material->caracteristics_point(point);
+
+void triangleMesh(Scene& scene, std::shared_ptr<Texture_Material> texture_material, const std::vector<int> &faceIndex
+                           , const std::vector<int> &vertexIndices, std::vector<Point3> points
+                           , const std::vector<Vector3> &normals, const std::vector<Point3>& textureCoordinates)
+{
+  //The normals and texture coordinates are given per face corner, so they are indexed by the corner
+  std::vector<std::uint32_t> indices;
+  std::vector<std::uint32_t> attribute_indices;
+  for (size_t i = 0, k = 0; i < faceIndex.size(); ++i) {
+    for (int j = 0; j < faceIndex[i] - 2; ++j) {
+      std::uint32_t corners[3] = {static_cast<std::uint32_t>(k), static_cast<std::uint32_t>(k + j + 1)
+                                  , static_cast<std::uint32_t>(k + j + 2)};
+      for (auto corner : corners) {
+        indices.push_back(vertexIndices[corner]);
+        attribute_indices.push_back(corner);
+      }
+    }
+    k += faceIndex[i];
+  }
+  scene.add_object(std::make_shared<TriangleMesh>(std::move(texture_material), std::move(points), std::move(indices)
+                                                  , normals, textureCoordinates, std::move(attribute_indices)));
 }
-*/
\ No newline at end of file
@@ -1,8 +1,54 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include "Object.hh"
 #include "Scene.hh"
+#include "BVH.hh"
+#include "TriangleBlock.hh"
+
+//Indexed triangle mesh registered in the scene as a single object
+//The vertices, normals and texture coordinates are shared between the triangles and the mesh has its own BVH
+//whose leaves are blocks of neighbouring triangles tested together
+class TriangleMesh : public Object {
+public:
+  //indices holds three vertex indices per triangle, attribute_indices three indices in normals and
+  //texture_coordinates per triangle, when it is empty the attributes are indexed like the vertices
+  //Without normals the triangles are flat shaded
+  TriangleMesh(std::shared_ptr<Texture_Material> texture_material, std::vector<Point3> vertices,
+               std::vector<std::uint32_t> indices, std::vector<Vector3> normals = {},
+               std::vector<Point3> texture_coordinates = {}, std::vector<std::uint32_t> attribute_indices = {});
+
+  std::optional<HitRecord> is_intersecting(const Rayon& ray) const override;
+
+  std::optional<HitRecord> find_nearest(const Rayon& ray, double t_min, double t_max) const override;
+
+  bool is_occluding(const Rayon& ray, double t_min, double t_max) const override;
+
+  void intersect_packet(const RayPacket& packet, double t_min, PacketHit& closest) const override;
+
+  Vector3 normal_at_point(const HitRecord& hit, const Point3& point, const Rayon& ray) const override;
+
+  Caracteristics texture_at_point(const HitRecord& hit, const Point3& point) const override;
+
+  std::optional<BoundingBox> bounding_box() const override;
+
+  [[nodiscard]] std::size_t triangle_count() const;
+
+  std::vector<Point3> vertices;
+  std::vector<std::uint32_t> indices;
+  std::vector<Vector3> normals;
+  std::vector<Point3> texture_coordinates; //TODO Actually it is a Point2
+  std::vector<std::uint32_t> attribute_indices;
+  std::vector<TriangleBlock> blocks;
+  BVH bvh; //Its primitives are block indices
+
+private:
+  [[nodiscard]] std::optional<HitRecord> intersect_triangle(std::uint32_t triangle, const Rayon& ray, double t_min,
+                                                            double t_max) const;
+
+  [[nodiscard]] std::uint32_t attribute_index(std::uint32_t triangle, int corner) const;
+};
 
 void triangleMesh(Scene& scene, std::shared_ptr<Texture_Material> texture_material, const std::vector<int> &faceIndex,
                const std::vector<int> &vertexIndices, std::vector<Point3> points, const std::vector<Vector3>& normals,
-               const std::vector<Point3>& textureCoordinates);
\ No newline at end of file
+               const std::vector<Point3>& textureCoordinates);
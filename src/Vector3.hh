@@ -1,45 +1,183 @@
 #pragma once
+#include <algorithm>
+#include <cmath>
 #include <optional>
+#include <ostream>
 
-class Vector3;
+//Precision of the whole renderer, chosen at build time with the RAYTRACING_FLOAT option
+//Float halves the memory taken by the meshes and the images, double is the reference
+#ifdef RAYTRACING_FLOAT
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
 
-using Point3 = Vector3;
-class Vector3
+//Every operation is defined in this header so that it is inlined and vectorized by the compiler in the hot loops
+template <typename T>
+class Vector3T
 {
  public:
-  Vector3();
-  Vector3(double x, double y, double z);
-  Vector3(const Point3& src, const Point3& dst);
+  Vector3T();
+  Vector3T(T x, T y, T z);
+  Vector3T(const Vector3T& src, const Vector3T& dst);
+
+  T x;
+  T y;
+  T z;
 
-  double x;
-  double y;
-  double z;
+  Vector3T operator*(T mul) const;
+  Vector3T operator*(const Vector3T &v) const;
+  Vector3T& operator*=(T t);
+  Vector3T& operator*=(const Vector3T &v);
 
-  Vector3 operator*(const double &mul) const;
-  Vector3 operator*(const Vector3 &v) const;
-  Vector3& operator*=(double t);
-  Vector3& operator*=(const Vector3 &v);
+  Vector3T operator+(const Vector3T &v) const;
+  Vector3T& operator+=(const Vector3T& v);
 
-  Vector3 operator+(const Vector3 &v) const;
-  Vector3& operator+=(const Vector3& v);
+  Vector3T operator-(const Vector3T &v) const;
+  Vector3T operator-() const;
 
-  Vector3 operator-(const Vector3 &v) const;
-  Vector3 operator-() const;
+  Vector3T operator/(T t) const;
+  Vector3T& operator/=(T t);
 
-  Vector3 operator/(double t);
-  Vector3& operator/=(double t);
+  T operator[](int axis) const;
+  T& operator[](int axis);
 
-  [[nodiscard]] double norm() const;
-  Vector3& normalize();
-  [[nodiscard]] double scalar_product(const Vector3 &v, bool only_positive = false) const;
-  [[nodiscard]] Vector3 vector_product(const Vector3 &v) const;
+  [[nodiscard]] T norm() const;
+  Vector3T& normalize();
+  [[nodiscard]] Vector3T normalized() const;
+  [[nodiscard]] T scalar_product(const Vector3T &v) const;
+  //Scalar product clamped to 0, for the lighting terms
+  [[nodiscard]] T positive_scalar_product(const Vector3T &v) const;
+  [[nodiscard]] Vector3T vector_product(const Vector3T &v) const;
 
+  //Not a template so that a double factor converts to T
+  friend Vector3T operator*(T mul, const Vector3T &v) {
+    return v * mul;
+  }
 };
 
+using Vector3 = Vector3T<Scalar>;
+using Point3 = Vector3;
 using Pixel = Vector3;
 
-std::ostream& operator<<(std::ostream &out, const Vector3& v);
-Vector3 operator*(const double &mul, const Vector3 &v);
+template <typename T>
+inline Vector3T<T>::Vector3T()
+    : x(0)
+    , y(0)
+    , z(0)
+{}
+
+template <typename T>
+inline Vector3T<T>::Vector3T(T x, T y, T z)
+    : x(x)
+    , y(y)
+    , z(z)
+{}
+
+template <typename T>
+inline Vector3T<T>::Vector3T(const Vector3T& src, const Vector3T& dst)
+    : Vector3T{dst.x - src.x, dst.y - src.y, dst.z - src.z}
+{}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator*(T mul) const {
+  return Vector3T(x * mul, y * mul, z * mul);
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator*(const Vector3T &v) const {
+  return Vector3T(this->x * v.x, this->y * v.y, this->z * v.z);
+}
+
+template <typename T>
+inline Vector3T<T>& Vector3T<T>::operator*=(T t) {
+  *this = *this * t;
+  return *this;
+}
+
+template <typename T>
+inline Vector3T<T>& Vector3T<T>::operator*=(const Vector3T &v) {
+  *this = *this * v;
+  return *this;
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator+(const Vector3T &v) const {
+  return Vector3T(this->x + v.x, this->y + v.y, this->z + v.z);
+}
+
+template <typename T>
+inline Vector3T<T>& Vector3T<T>::operator+=(const Vector3T& v) {
+  *this = *this + v;
+  return *this;
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator-(const Vector3T &v) const {
+  return Vector3T(this->x - v.x, this->y - v.y, this->z - v.z);
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator-() const {
+  return Vector3T(-this->x, -this->y, -this->z);
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::operator/(T t) const {
+  return (1 / t) * *this;
+}
+
+template <typename T>
+inline Vector3T<T>& Vector3T<T>::operator/=(T t) {
+  return *this *= 1 / t;
+}
+
+template <typename T>
+inline T Vector3T<T>::operator[](int axis) const {
+  return axis == 0 ? x : (axis == 1 ? y : z);
+}
+
+template <typename T>
+inline T& Vector3T<T>::operator[](int axis) {
+  return axis == 0 ? x : (axis == 1 ? y : z);
+}
+
+template <typename T>
+inline T Vector3T<T>::norm() const {
+  return std::sqrt(x * x + y * y + z * z);
+}
+
+template <typename T>
+inline Vector3T<T>& Vector3T<T>::normalize() {
+  *this = normalized();
+  return *this;
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::normalized() const {
+  T norm = this->norm();
+  return Vector3T(x / norm, y / norm, z / norm);
+}
+
+template <typename T>
+inline T Vector3T<T>::scalar_product(const Vector3T &v) const {
+  return this->x * v.x + this->y * v.y + this->z * v.z;
+}
+
+template <typename T>
+inline T Vector3T<T>::positive_scalar_product(const Vector3T &v) const {
+  return std::max(scalar_product(v), T(0));
+}
+
+template <typename T>
+inline Vector3T<T> Vector3T<T>::vector_product(const Vector3T &v) const {
+  return Vector3T(this->y * v.z - v.y * this->z, v.x * this->z - this->x * v.z, this->x * v.y - v.x * this->y);
+}
+
+template <typename T>
+std::ostream& operator<<(std::ostream &out, const Vector3T<T>& v) {
+  return out << "[" << v.x << ", " << v.y << ", " << v.z << "]";
+}
 
 std::optional<Vector3> refraction_vector(const Vector3& incident, Vector3 normal, double index_refraction);
 Vector3 reflection_vector(const Vector3& incident, const Vector3& normal);